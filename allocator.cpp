@@ -0,0 +1,114 @@
+#include "allocator.h"
+#include <algorithm>
+
+Allocator::Allocator(Disk &disk_, Bitmap &bitmap_) : disk(disk_), bitmap(bitmap_) {
+  int blocks_per_pista = disk.num_sectores / disk.sectors_per_block;
+  blocks_per_superficie = blocks_per_pista * disk.num_pistas;
+  extent_blocks = std::clamp(disk.intOption("extent_blocks", 16), 1, blocks_per_superficie);
+
+  // Por defecto 1/8 del disco para indices (index_region_pct=0 la desactiva)
+  int total = disk.totalBlocks();
+  int pct = std::clamp(disk.intOption("index_region_pct", 12), 0, 50);
+  index_region_start = std::max(FIRST_DATA_BLOCK, total - total * pct / 100);
+}
+
+// Libre en el bitmap y no reservado por otra relacion
+bool Allocator::isAvailable(int block, const std::string &relation) const {
+  if (bitmap.get(block)) return false;
+  for (const auto &[name, r] : reservations)
+    if (name != relation && block >= r.next && block < r.end) return false;
+  return true;
+}
+
+// Bloques disponibles consecutivos desde start sin cambiar de superficie
+int Allocator::runLength(int start, int max_len, const std::string &relation) const {
+  int superficie_end = (start / blocks_per_superficie + 1) * blocks_per_superficie;
+  int limit = std::min({start + max_len, superficie_end, index_region_start});
+  int len = 0;
+  while (start + len < limit && isAvailable(start + len, relation)) ++len;
+  return len;
+}
+
+// Primer hueco de al menos wanted bloques que empiece en [from, to)
+int Allocator::findRun(int from, int to, int wanted, const std::string &relation,
+                       int &len) const {
+  int start = bitmap.findFree(from, to);
+  while (start != -1) {
+    len = runLength(start, wanted, relation);
+    if (len >= wanted) return start;
+    // Si la corrida la corto el fin de la superficie o la region de indices,
+    // el bloque siguiente puede estar libre; si la corto un bloque ocupado o
+    // reservado, se sigue despues de el
+    int next = start + len;
+    if (next < to && !isAvailable(next, relation)) ++next;
+    start = bitmap.findFree(next, to);
+  }
+  return -1;
+}
+
+// Primero intenta extender la relacion a continuacion de su ultimo bloque;
+// si no, busca con next-fit un hueco de extent_blocks y va aceptando huecos
+// mas cortos cuando el disco esta fragmentado
+bool Allocator::reserveExtent(const std::string &relation, int last_block) {
+  if (last_block >= FIRST_DATA_BLOCK && last_block + 1 < index_region_start) {
+    int len = runLength(last_block + 1, extent_blocks, relation);
+    if (len > 0) {
+      reservations[relation] = {last_block + 1, last_block + 1 + len};
+      return true;
+    }
+  }
+
+  for (int wanted = extent_blocks; wanted >= 1; wanted /= 2) {
+    int len = 0;
+    int start = findRun(next_fit, index_region_start, wanted, relation, len);
+    if (start == -1) start = findRun(FIRST_DATA_BLOCK, next_fit, wanted, relation, len);
+    if (start != -1) {
+      reservations[relation] = {start, start + len};
+      next_fit = start + len < index_region_start ? start + len : FIRST_DATA_BLOCK;
+      return true;
+    }
+  }
+  return false;
+}
+
+int Allocator::allocateData(const std::string &relation, int last_block) {
+  auto it = reservations.find(relation);
+  while (it != reservations.end() && it->second.next < it->second.end &&
+         bitmap.get(it->second.next))
+    ++it->second.next;
+
+  if (it == reservations.end() || it->second.next >= it->second.end) {
+    if (!reserveExtent(relation, last_block)) {
+      // Sin huecos sin reservar: se toma cualquier bloque libre, primero de
+      // datos (aunque lo haya reservado otra relacion) y despues de indices
+      int block = bitmap.findFree(FIRST_DATA_BLOCK, disk.totalBlocks());
+      if (block != -1) bitmap.set(block, true);
+      return block;
+    }
+    it = reservations.find(relation);
+  }
+
+  int block = it->second.next++;
+  bitmap.set(block, true);
+  return block;
+}
+
+int Allocator::allocateIndex() {
+  int block = bitmap.findFree(index_region_start, disk.totalBlocks());
+  if (block == -1) {
+    // Region de indices llena: se toma un bloque de datos no reservado
+    for (int i = bitmap.findFree(FIRST_DATA_BLOCK, index_region_start);
+         i != -1 && block == -1; i = bitmap.findFree(i + 1, index_region_start))
+      if (isAvailable(i, "")) block = i;
+    if (block == -1)
+      block = bitmap.findFree(FIRST_DATA_BLOCK, index_region_start);
+  }
+  if (block != -1) bitmap.set(block, true);
+  return block;
+}
+
+void Allocator::freeBlock(int block) { bitmap.set(block, false); }
+
+void Allocator::releaseRelation(const std::string &relation) {
+  reservations.erase(relation);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "bitmap.h"
+#include "disk.h"
+#include <string>
+#include <unordered_map>
+
+// Asignacion de bloques por extents. Cada relacion reserva una corrida de
+// bloques consecutivos de la misma superficie y la va consumiendo en orden, asi
+// sus bloques quedan fisicamente contiguos aunque otras relaciones inserten en
+// paralelo. Los bloques de indices hash salen de una region propia al final
+// del disco.
+//
+// Los extents nuevos se buscan con next-fit: desde donde termino la ultima
+// reserva, dando la vuelta al final de la region de datos, asi no se vuelve a
+// recorrer el principio del disco ya ocupado en cada reserva.
+//
+// Las reservas viven solo en memoria: un bloque reservado pero no usado sigue
+// libre en el bitmap. Tras reiniciar, la relacion intenta seguir justo despues
+// de su ultimo bloque.
+class Allocator {
+public:
+  Allocator(Disk &disk, Bitmap &bitmap);
+
+  int allocateData(const std::string &relation, int last_block);
+  int allocateIndex();
+  void freeBlock(int block);
+  void releaseRelation(const std::string &relation);
+
+  int extentBlocks() const { return extent_blocks; }
+  int indexRegionStart() const { return index_region_start; }
+
+private:
+  struct Reservation {
+    int next;
+    int end;
+  };
+
+  static constexpr int FIRST_DATA_BLOCK = 2;
+
+  Disk &disk;
+  Bitmap &bitmap;
+  int extent_blocks;
+  int blocks_per_superficie;
+  int index_region_start;
+  int next_fit = FIRST_DATA_BLOCK;
+  std::unordered_map<std::string, Reservation> reservations;
+
+  bool isAvailable(int block, const std::string &relation) const;
+  int runLength(int start, int max_len, const std::string &relation) const;
+  int findRun(int from, int to, int wanted, const std::string &relation, int &len) const;
+  bool reserveExtent(const std::string &relation, int last_block);
+};
@@ -0,0 +1,173 @@
+#include "bench.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+
+// Recorre la relacion completa partiendo de un buffer pool vacio y sin la
+// imagen en la cache del kernel. Devuelve el tiempo total en ms.
+static double coldScanMs(SGBD &sgbd, const Relation &rel, int passes) {
+  using clock = std::chrono::steady_clock;
+  double total_ms = 0.0;
+  for (int p = 0; p < passes; ++p) {
+    sgbd.bufferManager->evictAll();
+    sgbd.disk.dropCache();
+
+    auto start = clock::now();
+    {
+      ScanGuard scan(*sgbd.bufferManager, rel.blocks);
+      for (int block_idx : rel.blocks)
+        ReadPageGuard page = ReadPageGuard::view(*sgbd.bufferManager, block_idx);
+    }
+    total_ms += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+  return total_ms;
+}
+
+void benchColdScan(SGBD &sgbd, const std::string &relation_name, int passes) {
+  if (!sgbd.catalog.hasRelation(relation_name)) {
+    std::cout << "Relación no encontrada: " << relation_name << std::endl;
+    return;
+  }
+  if (sgbd.disk.backend == BACKEND_DIRS || sgbd.disk.backend == BACKEND_MMAP) {
+    std::cout << "El recorrido en frio requiere backend=image o compressed" << std::endl;
+    return;
+  }
+  if (passes < 1) passes = 1;
+
+  const Relation &rel = sgbd.catalog.getRelation(relation_name);
+  double bytes = static_cast<double>(rel.blocks.size()) * sgbd.disk.block_size * passes;
+  bool was_direct = sgbd.disk.directIO();
+
+  std::cout << "==== Recorrido en frio: " << relation_name << " ("
+            << rel.blocks.size() << " bloques, " << passes << " pasadas) ====" << std::endl;
+  std::cout << std::left << std::setw(12) << "Modo" << std::setw(14) << "Tiempo (ms)"
+            << "MB/s" << std::endl;
+
+  for (bool direct : {false, true}) {
+    if (direct && sgbd.disk.backend != BACKEND_IMAGE) continue;
+    if (!sgbd.bufferManager->setDirectIO(direct)) continue;
+    double ms = coldScanMs(sgbd, rel, passes);
+    double mbps = ms > 0 ? (bytes / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0;
+    std::cout << std::left << std::setw(12) << (direct ? "directa" : "con cache")
+              << std::setw(14) << std::fixed << std::setprecision(3) << ms
+              << std::setprecision(2) << mbps << std::endl;
+  }
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+
+  sgbd.bufferManager->setDirectIO(was_direct);
+}
+
+// Latencia de un fallo con LRU segun el tamaño del pool. Un recorrido ciclico
+// sobre frames+1 bloques falla en cada acceso, asi que cada guard paga la
+// eleccion de victima mas una lectura (desde la cache del kernel).
+void benchLRUMiss(SGBD &sgbd, int max_frames) {
+  using clock = std::chrono::steady_clock;
+  if (sgbd.disk.backend == BACKEND_DIRS) {
+    std::cout << "La medicion requiere backend=image, mmap o compressed" << std::endl;
+    return;
+  }
+
+  int total_blocks = sgbd.disk.totalBlocks();
+  std::cout << "==== Latencia de fallo LRU ====" << std::endl;
+  std::cout << std::left << std::setw(10) << "Frames" << std::setw(12) << "Fallos"
+            << "us/fallo" << std::endl;
+
+  for (int frames : {16, 64, 256, 1024, 4096, 16384, 65536, 100000}) {
+    if (frames > max_frames) break;
+    if (frames + 1 > total_blocks) {
+      std::cout << std::left << std::setw(10) << frames
+                << "(el disco tiene " << total_blocks << " bloques)" << std::endl;
+      continue;
+    }
+
+    BufferManager pool(sgbd.disk, sgbd.scheduler, sgbd.wal, frames, "lru");
+    int cycle = frames + 1;
+    for (int b = 0; b < cycle; ++b)
+      ReadPageGuard page(pool, b);
+
+    int misses = std::max(20000, 2 * cycle);
+    auto start = clock::now();
+    for (int i = 0; i < misses; ++i)
+      ReadPageGuard page(pool, (cycle + i) % cycle);
+    double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+    std::cout << std::left << std::setw(10) << frames << std::setw(12) << misses
+              << std::fixed << std::setprecision(3) << us / misses << std::endl;
+  }
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+}
+
+struct MixedResult {
+  int accesses;
+  double hitrate;
+  double lookup_hitrate;
+};
+
+// Consultas puntuales sobre [0, hot) intercaladas con recorridos de
+// [hot, hot + scan). Con ring los recorridos van dentro de un ScanGuard.
+static MixedResult runMixed(SGBD &sgbd, const char *policy, int frames, int hot,
+                            int scan, bool ring) {
+  const int rounds = 10;
+  BufferManager pool(sgbd.disk, sgbd.scheduler, sgbd.wal, frames, policy);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick(0, hot - 1);
+  int lookups = 0, lookup_hits = 0;
+  ExtentList scan_blocks;
+  scan_blocks.addExtent(hot, scan);
+
+  auto lookup = [&]() {
+    int before = pool.hitCount();
+    ReadPageGuard page(pool, pick(rng));
+    ++lookups;
+    lookup_hits += pool.hitCount() - before;
+  };
+
+  for (int r = 0; r < rounds; ++r) {
+    for (int i = 0; i < 4 * hot; ++i)
+      lookup();
+    std::optional<ScanGuard> ring_scan;
+    if (ring) ring_scan.emplace(pool, scan_blocks);
+    for (int i = 0; i < scan; ++i) {
+      ReadPageGuard page(pool, hot + i);
+      page.release();
+      if (i % 4 == 3) lookup();
+    }
+  }
+  return {pool.accessCount(), 100.0 * pool.hitCount() / pool.accessCount(),
+          100.0 * lookup_hits / lookups};
+}
+
+// Carga mixta: consultas puntuales sobre un conjunto caliente de frames/2
+// bloques intercaladas con recorridos de 4*frames bloques. Compara cuanto del
+// conjunto caliente sobrevive a los recorridos con cada politica, y cuanto
+// cuando los recorridos usan el anillo de beginScan.
+void benchPolicies(SGBD &sgbd, int frames) {
+  int total_blocks = sgbd.disk.totalBlocks();
+  int hot = std::max(1, frames / 2);
+  int scan = std::min(4 * frames, total_blocks - hot);
+  if (frames < 2 || scan < frames) {
+    std::cout << "El disco no alcanza para recorrer mas bloques que frames" << std::endl;
+    return;
+  }
+
+  std::cout << "==== Politicas con carga mixta (" << frames << " frames, " << hot
+            << " bloques calientes, recorridos de " << scan << ") ====" << std::endl;
+  std::cout << std::left << std::setw(10) << "Politica" << std::setw(12) << "Accesos"
+            << std::setw(14) << "Hitrate (%)" << std::setw(22) << "Hitrate puntual (%)"
+            << "Puntual con anillo (%)" << std::endl;
+
+  for (const char *policy : {"lru", "clock", "2q", "lru2", "arc"}) {
+    MixedResult plain = runMixed(sgbd, policy, frames, hot, scan, false);
+    MixedResult ring = runMixed(sgbd, policy, frames, hot, scan, true);
+    std::cout << std::left << std::setw(10) << policy << std::setw(12) << plain.accesses
+              << std::setw(14) << std::fixed << std::setprecision(2) << plain.hitrate
+              << std::setw(22) << plain.lookup_hitrate << ring.lookup_hitrate << std::endl;
+  }
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "sgbd.h"
+#include <string>
+
+// Mediciones de rendimiento invocables desde la shell
+void benchColdScan(SGBD &sgbd, const std::string &relation_name, int passes);
+void benchLRUMiss(SGBD &sgbd, int max_frames);
+void benchPolicies(SGBD &sgbd, int frames);
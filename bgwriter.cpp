@@ -0,0 +1,78 @@
+#include "bgwriter.h"
+#include <cstring>
+
+BackgroundWriter::BackgroundWriter(Disk &disk_)
+    : disk(disk_), worker(&BackgroundWriter::run, this) {}
+
+// Las escrituras encoladas se terminan antes de salir
+BackgroundWriter::~BackgroundWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_cv.notify_one();
+  worker.join();
+}
+
+void BackgroundWriter::submit(int block_id, const char *src) {
+  BlockBuffer copy(disk.block_size);
+  std::memcpy(copy.data(), src, disk.block_size);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({block_id, std::move(copy)});
+    ++in_flight;
+  }
+  work_cv.notify_one();
+}
+
+std::vector<std::pair<int, bool>> BackgroundWriter::takeCompleted() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::pair<int, bool>> result(done.begin(), done.end());
+  done.clear();
+  return result;
+}
+
+// Espera la escritura de un bloque ya encolado y devuelve si salio bien
+bool BackgroundWriter::waitFor(int block_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [&] { return done.count(block_id) > 0; });
+  bool ok = done[block_id];
+  done.erase(block_id);
+  return ok;
+}
+
+void BackgroundWriter::drain() {
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [&] { return in_flight == 0; });
+}
+
+void BackgroundWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_cv.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (pending.empty()) return;
+
+    std::vector<Job> batch(std::make_move_iterator(pending.begin()),
+                           std::make_move_iterator(pending.end()));
+    pending.clear();
+    lock.unlock();
+
+    std::vector<int> ids;
+    std::vector<const char *> buffers;
+    for (const Job &job : batch) {
+      ids.push_back(job.block_id);
+      buffers.push_back(job.data.data());
+    }
+    std::vector<bool> written(ids.size(), false);
+    try {
+      written = disk.writeBlocks(ids, buffers);
+    } catch (...) {
+    }
+
+    lock.lock();
+    for (size_t i = 0; i < ids.size(); ++i)
+      done[ids[i]] = written[i];
+    in_flight -= static_cast<int>(ids.size());
+    done_cv.notify_all();
+  }
+}
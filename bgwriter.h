@@ -0,0 +1,45 @@
+#pragma once
+
+#include "disk.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Hilo de escritura de fondo. submit copia el bloque, asi el frame sigue
+// disponible mientras se escribe; el hilo vuelca la cola con
+// Disk::writeBlocks. Como en Prefetcher, los resultados se retiran con
+// takeCompleted o waitFor.
+class BackgroundWriter {
+public:
+  BackgroundWriter(Disk &disk_);
+  ~BackgroundWriter();
+  BackgroundWriter(const BackgroundWriter &) = delete;
+  BackgroundWriter &operator=(const BackgroundWriter &) = delete;
+
+  void submit(int block_id, const char *src);
+  std::vector<std::pair<int, bool>> takeCompleted();
+  bool waitFor(int block_id);
+  void drain();
+
+private:
+  struct Job {
+    int block_id;
+    BlockBuffer data;
+  };
+
+  Disk &disk;
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  std::deque<Job> pending;
+  std::unordered_map<int, bool> done;
+  int in_flight = 0;
+  bool stopping = false;
+  std::thread worker;
+
+  void run();
+};
@@ -1,5 +1,5 @@
 #include "bitmap.h"
-#include <cstring>
+#include <algorithm>
 #include <stdexcept>
 
 Bitmap::Bitmap(Disk &disk_) : disk(disk_) {
@@ -8,58 +8,157 @@ Bitmap::Bitmap(Disk &disk_) : disk(disk_) {
   int bloques_por_plato = bloques_por_superficie * disk.num_superficies;
   total_blocks = bloques_por_plato * disk.num_platos;
 
-  bits.resize(total_blocks, false);
+  int bytes = (total_blocks + 7) / 8;
+  storage_count = (bytes + disk.block_size - 1) / disk.block_size;
+  if (storage_count + 1 >= total_blocks)
+    throw std::runtime_error("Disco demasiado pequeño para el bitmap");
+
+  reset();
+}
+
+// Todo libre salvo los bloques que ocupa el propio bitmap. Los bits de
+// relleno de la ultima palabra quedan a 1 para que nunca parezcan libres.
+void Bitmap::reset() {
+  int num_words = (total_blocks + 63) / 64;
+  words.assign(num_words, 0);
+  if (total_blocks % 64)
+    words.back() = ~0ULL << (total_blocks % 64);
+  free_summary.assign((num_words + 63) / 64, 0);
+  for (int w = 0; w < num_words; ++w)
+    updateSummary(w);
+
+  dirty_blocks.assign(storage_count, true);
+  for (int i = 0; i < storage_count; ++i)
+    set(storageBlock(i), true);
+}
+
+void Bitmap::updateSummary(int word) {
+  uint64_t mask = 1ULL << (word % 64);
+  if (words[word] != ~0ULL)
+    free_summary[word / 64] |= mask;
+  else
+    free_summary[word / 64] &= ~mask;
 }
 
+// El bloque 1 es del catalogo, asi que el bitmap sigue en el 2
+int Bitmap::storageBlock(int i) const { return i == 0 ? 0 : i + 1; }
+
 void Bitmap::set(int index, bool value) {
   if (index < 0 || index >= total_blocks)
     throw std::out_of_range("Bitmap set: índice fuera de rango");
-  bits[index] = value;
+  uint64_t mask = 1ULL << (index % 64);
+  uint64_t &word = words[index / 64];
+  if (((word & mask) != 0) == value)
+    return;
+  word ^= mask;
+  updateSummary(index / 64);
+  dirty_blocks[index / 8 / disk.block_size] = true;
 }
 
 bool Bitmap::get(int index) const {
   if (index < 0 || index >= total_blocks)
     throw std::out_of_range("Bitmap get: índice fuera de rango");
-  return bits[index];
+  return (words[index / 64] >> (index % 64)) & 1;
 }
 
+// El formato en disco es el de siempre: bit i en el byte i/8, posicion i%8
 bool Bitmap::load() {
-  std::vector<char> data = disk.readBlock(0);
-  if ((int)data.size() < (total_blocks + 7) / 8)
-    return false;
+  int bytes = (total_blocks + 7) / 8;
+  std::vector<uint64_t> loaded((total_blocks + 63) / 64, 0);
+  std::vector<char> data(disk.block_size);
 
-  bits.assign(total_blocks, false);
-  for (int i = 0; i < total_blocks; ++i) {
-    bits[i] = (data[i / 8] & (1 << (i % 8))) != 0;
+  for (int i = 0; i < storage_count; ++i) {
+    int first = i * disk.block_size;
+    int len = std::min(disk.block_size, bytes - first);
+    disk.readBlockInto(storageBlock(i), data.data());
+    for (int j = 0; j < len; ++j) {
+      int byte = first + j;
+      loaded[byte / 8] |= (uint64_t)(unsigned char)data[j] << (8 * (byte % 8));
+    }
   }
 
-  if (!bits[0] || !bits[1])
+  if (total_blocks % 64)
+    loaded.back() |= ~0ULL << (total_blocks % 64);
+  if (!(loaded[0] & 1) || !(loaded[0] & 2))
     return false;
+  for (int i = 1; i < storage_count; ++i) {
+    int b = storageBlock(i);
+    if (!((loaded[b / 64] >> (b % 64)) & 1))
+      return false;
+  }
 
+  words = std::move(loaded);
+  for (int w = 0; w < (int)words.size(); ++w)
+    updateSummary(w);
+  dirty_blocks.assign(storage_count, false);
   return true;
 }
 
-void Bitmap::save() const {
-  std::vector<char> data((total_blocks + 7) / 8, 0);
-  for (int i = 0; i < total_blocks; ++i) {
-    if (bits[i]) {
-      data[i / 8] |= (1 << (i % 8));
-    }
-  }
+void Bitmap::save() {
+  BlockImages pages;
+  save(pages);
+  for (const auto &[block, data] : pages)
+    disk.writeBlock(block, data);
+}
 
-  std::vector<char> block(disk.block_size, 0);
-  std::memcpy(block.data(), data.data(), std::min(data.size(), block.size()));
+void Bitmap::save(BlockImages &pages) {
+  int bytes = (total_blocks + 7) / 8;
+  for (int i = 0; i < storage_count; ++i) {
+    if (!dirty_blocks[i])
+      continue;
 
-  disk.writeBlock(0, block);
+    std::vector<char> block(disk.block_size, 0);
+    int first = i * disk.block_size;
+    int len = std::min(disk.block_size, bytes - first);
+    for (int j = 0; j < len; ++j) {
+      int byte = first + j;
+      block[j] = (char)(words[byte / 8] >> (8 * (byte % 8)));
+    }
+    // Los bits de relleno no se guardan
+    if (first + len == bytes && total_blocks % 8)
+      block[len - 1] &= (char)((1 << (total_blocks % 8)) - 1);
+
+    pages[storageBlock(i)] = std::move(block);
+    dirty_blocks[i] = false;
+  }
 }
 
 int Bitmap::size() const { return total_blocks; }
 
-int Bitmap::getFreeBlock() const {
-  for (int i = 2; i < total_blocks; ++i) {
-    if (!bits[i]) {
-      return i;
+int Bitmap::storageBlocks() const { return storage_count; }
+
+// Primera palabra en [from_word, to_word) con algun bloque libre
+int Bitmap::findFreeWord(int from_word, int to_word) const {
+  if (from_word >= to_word)
+    return -1;
+  int s = from_word / 64;
+  uint64_t pending = free_summary[s] & (~0ULL << (from_word % 64));
+  while (true) {
+    if (pending) {
+      int w = s * 64 + __builtin_ctzll(pending);
+      return w < to_word ? w : -1;
     }
+    if (++s >= (int)free_summary.size() || s * 64 >= to_word)
+      return -1;
+    pending = free_summary[s];
+  }
+}
+
+// Primer bloque libre en [from, to), o -1
+int Bitmap::findFree(int from, int to) const {
+  from = std::max(from, 0);
+  to = std::min(to, total_blocks);
+  if (from >= to)
+    return -1;
+
+  int w = from / 64;
+  uint64_t free_bits = ~words[w] & (~0ULL << (from % 64));
+  if (!free_bits) {
+    w = findFreeWord(w + 1, (to + 63) / 64);
+    if (w == -1)
+      return -1;
+    free_bits = ~words[w];
   }
-  return -1;
+  int block = w * 64 + __builtin_ctzll(free_bits);
+  return block < to ? block : -1;
 }
@@ -1,18 +1,35 @@
 #pragma once
 #include "disk.h"
+#include <cstdint>
 #include <vector>
 
+// Mapa de bloques libres empaquetado en palabras de 64 bits (bit a 1 = usado).
+// free_summary tiene un bit por palabra que indica si le queda algun bloque
+// libre, asi la busqueda salta de a 4096 bloques sobre zonas llenas.
+//
+// En disco ocupa el bloque 0 y, si no entra, los bloques 2, 3, ... a
+// continuacion del catalogo. save() solo reescribe los bloques modificados.
 class Bitmap {
-  std::vector<bool> bits;
+  std::vector<uint64_t> words;
+  std::vector<uint64_t> free_summary;
+  std::vector<bool> dirty_blocks;
   int total_blocks;
+  int storage_count;
   Disk &disk;
 
+  void reset();
+  void updateSummary(int word);
+  int storageBlock(int i) const;
+  int findFreeWord(int from_word, int to_word) const;
+
 public:
   Bitmap(Disk &disk_);
   void set(int index, bool value);
   bool get(int index) const;
   bool load();
-  void save() const;
+  void save();
+  void save(BlockImages &pages); // deja los bloques cambiados en pages
   int size() const;
-  int getFreeBlock() const;
+  int storageBlocks() const;
+  int findFree(int from, int to) const;
 };
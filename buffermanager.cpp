@@ -1,224 +1,282 @@
 #include "buffermanager.h"
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
-#include <stdexcept>
-
-BufferManager::BufferManager(Disk &disk_, int frame_count_, const std::string &policy)
-  : disk(disk_), frame_count(frame_count_), current_time(0), clock_hand(0) {
-  if (policy == "lru") replacement_policy = LRU;
-  else if (policy == "clock") replacement_policy = CLOCK;
-  else throw std::invalid_argument("Política de reemplazo no reconocida");
-
-  frames.resize(frame_count);
-  for (int i = 0; i < frame_count; ++i) {
-    frames[i].block_id = -1;
-    frames[i].dirty = false;
-    frames[i].time = -1;
-    frames[i].pin_count = 0;
-    frames[i].ref_bit = false;
-    frames[i].data.resize(disk.block_size);
+#include <iostream>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+BufferManager::BufferManager(Disk &disk_, IOScheduler &scheduler_, WriteAheadLog &wal_,
+                             int frame_count_, const std::string &policy)
+    : disk(disk_), warm_path((fs::path(disk_.root_path) / "warm.set").string()),
+      warm_by_frequency(disk_.stringOption("buffer_warm_order", "recency") == "frequency"),
+      frame_count(frame_count_) {
+  int auto_shards = std::clamp(frame_count / 64, 1, 8);
+  int count = std::clamp(disk_.intOption("buffer_shards", auto_shards), 1, frame_count);
+
+  // Los frames que sobran de la division van a los primeros shards
+  for (int i = 0; i < count; ++i) {
+    int frames = frame_count / count + (i < frame_count % count ? 1 : 0);
+    shards.push_back(
+        std::make_unique<BufferShard>(disk_, scheduler_, wal_, frames, policy, i, count));
   }
 }
 
-std::vector<char> &BufferManager::getBlock(int block_id) {
-  ++total_accesses;
-  ++current_time;
+BufferShard &BufferManager::shardFor(int block_id) const {
+  return *shards[shardOfBlock(block_id, static_cast<int>(shards.size()))];
+}
 
-  auto it = block_to_frame.find(block_id);
-  if (it != block_to_frame.end()) {
-    ++cache_hits;
-    int frame_idx = it->second;
-    frames[frame_idx].time = current_time;
-    if (replacement_policy == CLOCK) frames[frame_idx].ref_bit = true;
-    return frames[frame_idx].data;
-  }
+FrameRef BufferManager::fix(int block_id) { return shardFor(block_id).fix(block_id); }
 
-  int frame_idx = evictFrame();
+FrameRef BufferManager::fixView(int block_id) { return shardFor(block_id).fixView(block_id); }
 
-  if (frames[frame_idx].dirty && frames[frame_idx].block_id != -1) {
-    disk.writeBlock(frames[frame_idx].block_id, frames[frame_idx].data);
-  }
+void BufferManager::flushBlock(int block_id) { shardFor(block_id).flushBlock(block_id); }
+
+void BufferManager::discardBlock(int block_id) { shardFor(block_id).discardBlock(block_id); }
 
-  loadBlock(block_id, frame_idx);
-  block_to_frame[block_id] = frame_idx;
-  return frames[frame_idx].data;
+void BufferManager::flushAll() {
+  for (auto &shard : shards) shard->flushAll();
+  saveWarmSet();
 }
 
-void BufferManager::markDirty(int block_id) {
-  auto it = block_to_frame.find(block_id);
-  if (it != block_to_frame.end()) {
-    frames[it->second].dirty = true;
+// Una linea con el orden y despues un bloque por linea, del mas caliente al
+// mas frio. Las listas de los shards se intercalan para que un pool mas chico
+// al reiniciar se quede con lo mas caliente de cada uno.
+void BufferManager::saveWarmSet() const {
+  std::vector<std::vector<int>> lists;
+  size_t longest = 0;
+  for (const auto &shard : shards) {
+    lists.push_back(shard->warmSet(warm_by_frequency));
+    longest = std::max(longest, lists.back().size());
   }
-}
 
-void BufferManager::pin(int block_id) {
-  auto it = block_to_frame.find(block_id);
-  if (it != block_to_frame.end()) {
-    frames[it->second].pin_count++;
+  std::string tmp_path = warm_path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    if (!ofs) return;
+    ofs << (warm_by_frequency ? "frequency" : "recency") << "\n";
+    for (size_t i = 0; i < longest; ++i)
+      for (const auto &list : lists)
+        if (i < list.size()) ofs << list[i] << "\n";
+    if (!ofs) return;
   }
+  std::error_code ec;
+  fs::rename(tmp_path, warm_path, ec);
 }
 
-void BufferManager::unpin(int block_id) {
-  auto it = block_to_frame.find(block_id);
-  if (it != block_to_frame.end()) {
-    if (frames[it->second].pin_count > 0) {
-      frames[it->second].pin_count--;
-    } else {
-      throw std::runtime_error("Intento de unpin a un bloque no pineado");
+// Cada shard carga su parte del mas frio al mas caliente, de a WARM_BATCH
+// bloques por lote; solo ocupa frames vacios
+int BufferManager::preloadWarmSet() {
+  std::ifstream ifs(warm_path);
+  std::string order;
+  if (!ifs || !std::getline(ifs, order)) return 0;
+
+  int count = static_cast<int>(shards.size());
+  std::vector<std::vector<int>> per_shard(count);
+  std::unordered_set<int> seen;
+  int total = 0;
+  int block_id;
+  while (total < frame_count && ifs >> block_id) {
+    if (block_id < 0 || block_id >= disk.totalBlocks() || !seen.insert(block_id).second)
+      continue;
+    per_shard[shardOfBlock(block_id, count)].push_back(block_id);
+    ++total;
+  }
+  if (total == 0) return 0;
+
+  auto start = std::chrono::steady_clock::now();
+  int done = 0;
+  int loaded = 0;
+  for (int s = 0; s < count; ++s) {
+    const std::vector<int> &list = per_shard[s];
+    for (size_t end = list.size(); end > 0;) {
+      size_t begin = end > WARM_BATCH ? end - WARM_BATCH : 0;
+      loaded += shards[s]->preload(std::vector<int>(list.begin() + begin, list.begin() + end));
+      done += static_cast<int>(end - begin);
+      end = begin;
+      std::cout << "\rPrecarga del buffer pool: " << done << "/" << total << " bloques"
+                << std::flush;
     }
   }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << "\rPrecarga del buffer pool: " << loaded << " bloques (orden " << order
+            << ") en " << elapsed.count() << " ms" << std::endl;
+  return loaded;
 }
 
-void BufferManager::flushBlock(int block_id) {
-  auto it = block_to_frame.find(block_id);
-  if (it != block_to_frame.end()) {
-    int idx = it->second;
-    if (frames[idx].dirty) {
-      disk.writeBlock(block_id, frames[idx].data);
-      frames[idx].dirty = false;
-    }
+int BufferManager::dirtyCount() const {
+  int dirty = 0;
+  for (const auto &shard : shards) dirty += shard->dirtyCount();
+  return dirty;
+}
+
+int BufferManager::hitCount() const { return totals().hits; }
+
+int BufferManager::accessCount() const { return totals().accesses; }
+
+void BufferManager::evictAll() {
+  for (auto &shard : shards) shard->evictAll();
+}
+
+void BufferManager::beginScan(const ExtentList &block_ids) {
+  for (auto &shard : shards) shard->beginScan(block_ids);
+}
+
+void BufferManager::endScan() {
+  for (auto &shard : shards) shard->endScan();
+}
+
+void BufferManager::setPrefetchWindow(int window) {
+  for (auto &shard : shards) shard->setPrefetchWindow(window);
+}
+
+bool BufferManager::resize(int new_frame_count) {
+  if (new_frame_count < static_cast<int>(shards.size())) {
+    std::cerr << "El pool necesita al menos " << shards.size() << " frames (uno por shard)"
+              << std::endl;
+    return false;
   }
+  return reconfigure(new_frame_count, shards.front()->replacementPolicy());
 }
 
-void BufferManager::flushAll() {
-  for (Frame &frame : frames) {
-    if (frame.dirty && frame.block_id != -1) {
-      disk.writeBlock(frame.block_id, frame.data);
-      frame.dirty = false;
-    }
+bool BufferManager::setPolicy(const std::string &name) {
+  ReplacementPolicy policy;
+  if (!parsePolicy(name, policy)) {
+    std::cerr << "Politica invalida (lru / clock / 2q / lru2 / arc)" << std::endl;
+    return false;
   }
+  return reconfigure(frame_count, policy);
 }
 
-int BufferManager::evictFrame() {
-  return (replacement_policy == LRU) ? evictLRU() : evictClock();
+bool BufferManager::setDirectIO(bool enable) {
+  bool was_direct = disk.directIO();
+  if (!disk.setDirectIO(enable)) return false;
+  if (was_direct == enable) return true;
+  if (reconfigure(frame_count, shards.front()->replacementPolicy())) return true;
+  disk.setDirectIO(was_direct);
+  return false;
 }
 
-int BufferManager::evictLRU() {
-  int oldest_time = current_time + 1;
-  int evict_idx = -1;
-  for (int i = 0; i < frame_count; ++i) {
-    if (frames[i].block_id == -1)
-      return i;
-    if (frames[i].time < oldest_time && frames[i].pin_count == 0) {
-      oldest_time = frames[i].time;
-      evict_idx = i;
+// Todo o nada: con los latches de todos los shards tomados (siempre en el
+// mismo orden) se comprueba que ninguno tenga frames pineados antes de tocar
+// el primero. Si un shard falla al escribir sus sucios, los ya cambiados
+// vuelven a su tamaño y politica anteriores.
+bool BufferManager::reconfigure(int new_frame_count, ReplacementPolicy policy) {
+  std::vector<std::unique_lock<std::recursive_mutex>> latches;
+  for (const auto &shard : shards) latches.push_back(shard->lockShard());
+  for (const auto &shard : shards) {
+    if (shard->hasPinnedFrames()) {
+      std::cerr << "Hay frames pineados; el pool no se reconfiguro" << std::endl;
+      return false;
     }
   }
-  if (evict_idx == -1)
-    throw std::runtime_error("No se puede desalojar ningún frame (LRU)");
-
-  block_to_frame.erase(frames[evict_idx].block_id);
-  return evict_idx;
-}
-
-int BufferManager::evictClock() {
-  int scanned = 0;
-  while (scanned < frame_count * 2) {
-    Frame &f = frames[clock_hand];
-    if (f.pin_count == 0) {
-      if (!f.ref_bit) {
-        int evict_idx = clock_hand;
-        if (f.block_id != -1)
-          block_to_frame.erase(f.block_id);
-        clock_hand = (clock_hand + 1) % frame_count;
-        return evict_idx;
-      } else {
-        f.ref_bit = false;
+
+  int count = static_cast<int>(shards.size());
+  ReplacementPolicy old_policy = shards.front()->replacementPolicy();
+  int done = 0;
+  try {
+    for (; done < count; ++done) {
+      int frames = new_frame_count / count + (done < new_frame_count % count ? 1 : 0);
+      shards[done]->reconfigure(frames, policy);
+    }
+  } catch (...) {
+    for (int i = 0; i < done; ++i) {
+      int frames = frame_count / count + (i < frame_count % count ? 1 : 0);
+      try {
+        shards[i]->reconfigure(frames, old_policy);
+      } catch (const std::exception &e) {
+        std::cerr << "No se pudo restaurar el shard " << i << ": " << e.what() << std::endl;
       }
     }
-    clock_hand = (clock_hand + 1) % frame_count;
-    scanned++;
+    throw;
   }
-
-  throw std::runtime_error("No se puede desalojar ningún frame (Clock)");
+  frame_count = new_frame_count;
+  return true;
 }
 
-void BufferManager::loadBlock(int block_id, int frame_index) {
-  frames[frame_index].data = disk.readBlock(block_id);
-  frames[frame_index].block_id = block_id;
-  frames[frame_index].dirty = false;
-  frames[frame_index].time = current_time;
-  frames[frame_index].pin_count = 0;
-  frames[frame_index].ref_bit = (replacement_policy == CLOCK);
-}
+std::string BufferManager::policyName() const { return shards.front()->policyName(); }
 
-void BufferManager::printStatus() const {
-  std::cout << "=== Estado del Buffer Manager (" 
-            << (replacement_policy == LRU ? "LRU" : "Clock") 
-            << ") ===\n";
-  if (replacement_policy == LRU)
-    printStatusLRU();
-  else
-    printStatusClock();
-  printHitRate();
+void BufferManager::trickleDirty() {
+  for (auto &shard : shards) shard->trickleDirty();
 }
 
-void BufferManager::printStatusLRU() const {
-  const int w_idx = 8, w_block = 10, w_dirty = 8, w_time = 10, w_pincnt = 10;
-
-  std::cout << std::left
-            << std::setw(w_idx) << "Indice"
-            << std::setw(w_block) << "Bloque"
-            << std::setw(w_dirty) << "Dirty"
-            << std::right
-            << std::setw(w_time) << "Tiempo"
-            << std::setw(w_pincnt) << "PinCount"
-            << '\n';
-
-  std::cout << std::string(w_idx + w_block + w_dirty + w_time + w_pincnt, '-') << "\n";
-
-  for (int i = 0; i < frame_count; ++i) {
-    const Frame &f = frames[i];
-    std::cout << std::left
-              << std::setw(w_idx) << i
-              << std::setw(w_block) << f.block_id
-              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
-              << std::right
-              << std::setw(w_time) << f.time
-              << std::setw(w_pincnt) << f.pin_count
-              << '\n';
+BufferCounters BufferManager::totals() const {
+  BufferCounters sum;
+  for (const auto &shard : shards) {
+    BufferCounters c = shard->counters();
+    sum.accesses += c.accesses;
+    sum.hits += c.hits;
+    sum.zero_copy_reads += c.zero_copy_reads;
+    sum.ring_reuses += c.ring_reuses;
+    sum.prefetch_issued += c.prefetch_issued;
+    sum.prefetch_hits += c.prefetch_hits;
+    sum.prefetch_wasted += c.prefetch_wasted;
+    sum.bg_rounds += c.bg_rounds;
+    sum.bg_writes += c.bg_writes;
+    sum.eviction_writes += c.eviction_writes;
+    sum.warm_loaded += c.warm_loaded;
+    sum.warm_hits += c.warm_hits;
   }
+  return sum;
 }
 
-void BufferManager::printStatusClock() const {
-  const int w_idx = 8, w_block = 10, w_dirty = 8, w_refbit = 10, w_pincnt = 10;
-
-  std::cout << std::left
-            << std::setw(w_idx) << "Indice"
-            << std::setw(w_block) << "Bloque"
-            << std::setw(w_dirty) << "Dirty"
-            << std::setw(w_refbit) << "RefBit"
-            << std::right
-            << std::setw(w_pincnt) << "PinCount"
-            << '\n';
-
-  std::cout << std::string(w_idx + w_block + w_dirty + w_refbit + w_pincnt, '-') << "\n";
-
-  for (int i = 0; i < frame_count; ++i) {
-    const Frame &f = frames[i];
-    std::cout << std::left
-              << std::setw(w_idx) << i
-              << std::setw(w_block) << f.block_id
-              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
-              << std::setw(w_refbit) << (f.ref_bit ? "1" : "0")
-              << std::right
-              << std::setw(w_pincnt) << f.pin_count;
-
-    if (i == clock_hand)
-      std::cout << "  <--- reloj";
+void BufferManager::printPrefetchInfo() const {
+  const BufferShard &first = *shards.front();
+  BufferCounters c = totals();
+  std::cout << "Ventana de prefetch: " << first.prefetchWindow();
+  if (first.prefetchWindow() > 0 && !first.prefetchEnabled())
+    std::cout << " (sin efecto con backend=mmap)";
+  std::cout << "\nLecturas anticipadas: " << c.prefetch_issued << "\n"
+            << "Usadas             : " << c.prefetch_hits << "\n"
+            << "Desperdiciadas     : " << c.prefetch_wasted << "\n";
+}
 
-    std::cout << '\n';
+// Con un solo shard la salida es la de siempre
+void BufferManager::printStatus() const {
+  if (shards.size() == 1) {
+    shards.front()->printStatus();
+    return;
+  }
+  for (size_t i = 0; i < shards.size(); ++i) {
+    std::cout << "\n##### Shard " << i << " (" << shards[i]->frameCount() << " frames) #####\n";
+    shards[i]->printStatus();
   }
+  std::cout << "\n##### Total (" << shards.size() << " shards, " << frame_count
+            << " frames) #####";
+  printHitRate();
 }
 
 void BufferManager::printHitRate() const {
+  if (shards.size() == 1) {
+    shards.front()->printHitRate();
+    return;
+  }
+  BufferCounters c = totals();
   std::cout << "\n=== Estadísticas de Hitrate ===\n";
-  std::cout << "Accesos totales: " << total_accesses << "\n";
-  std::cout << "Hits de caché  : " << cache_hits << "\n";
-  if (total_accesses > 0) {
-    double hitrate = 100.0 * cache_hits / total_accesses;
+  std::cout << "Accesos totales: " << c.accesses << "\n";
+  std::cout << "Hits de caché  : " << c.hits << "\n";
+  if (c.zero_copy_reads > 0)
+    std::cout << "Lecturas mmap  : " << c.zero_copy_reads << "\n";
+  if (c.ring_reuses > 0)
+    std::cout << "Reusos anillo  : " << c.ring_reuses << "\n";
+  if (c.bg_writes > 0 || c.eviction_writes > 0)
+    std::cout << "Escritura fondo: " << c.bg_writes << " en " << c.bg_rounds << " rondas, "
+              << c.eviction_writes << " al desalojar\n";
+  if (c.prefetch_issued > 0)
+    std::cout << "Prefetch       : " << c.prefetch_issued << " leidos, " << c.prefetch_hits
+              << " usados, " << c.prefetch_wasted << " desperdiciados\n";
+  if (c.accesses > 0) {
+    double hitrate = 100.0 * c.hits / c.accesses;
     std::cout << std::fixed << std::setprecision(2)
               << "Hitrate        : " << hitrate << "%\n";
+    if (c.warm_loaded > 0)
+      std::cout << "Precarga       : " << c.warm_loaded << " bloques, " << c.warm_hits
+                << " fallos evitados (hitrate sin precarga "
+                << 100.0 * (c.hits - c.warm_hits) / c.accesses << "%)\n";
   } else {
     std::cout << "Hitrate        : N/A (sin accesos)\n";
   }
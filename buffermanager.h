@@ -1,52 +1,77 @@
 #pragma once
 
-#include "disk.h"
+#include "buffershard.h"
+#include <memory>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-struct Frame {
-  int block_id;
-  bool dirty;
-  int time;
-  int pin_count;
-  bool ref_bit;
-  std::vector<char> data;
-};
-
-enum ReplacementPolicy { LRU, CLOCK };
-
+// Buffer pool repartido en shards por bloque (ver shardOfBlock). Cada shard
+// tiene sus frames, su latch y su estado de reemplazo, asi varios hilos
+// pueden leer bloques de shards distintos en paralelo. La cantidad sale de
+// buffer_shards en disk.cfg; por defecto un shard cada 64 frames, hasta 8.
+//
+// Los bloques se acceden solo con los guards de pageguard.h, que usan
+// fix/fixView para traer y pinear en un paso y unfix al soltarlos.
 class BufferManager {
 public:
-  BufferManager(Disk &disk_, int frame_count_, const std::string &policy);
+  BufferManager(Disk &disk_, IOScheduler &scheduler_, WriteAheadLog &wal_,
+                int frame_count_, const std::string &policy);
 
-  std::vector<char> &getBlock(int block_id);
-  void markDirty(int block_id);
-  void pin(int block_id);
-  void unpin(int block_id);
+  FrameRef fix(int block_id);
+  FrameRef fixView(int block_id);
   void flushBlock(int block_id);
+  // Para bloques liberados: saca el frame del pool sin escribirlo
+  void discardBlock(int block_id);
   void flushAll();
+  int dirtyCount() const;
+  int hitCount() const;
+  int accessCount() const;
+  void evictAll();
+
+  // Los recorridos y la escritura de fondo se aplican a todos los shards;
+  // cada uno atiende solo sus bloques de la lista. Los recorridos se abren
+  // con ScanGuard (pageguard.h), que garantiza el endScan.
+  void beginScan(const ExtentList &block_ids);
+  void endScan();
+  void setPrefetchWindow(int window);
+  void printPrefetchInfo() const;
+  void trickleDirty();
+
+  // buffer_resize / buffer_policy: reconfiguran cada shard en caliente. El
+  // numero de shards no cambia, asi ningun bloque cambia de shard; por eso
+  // el pool no puede tener menos frames que shards. Devuelven false si no se
+  // pudo (valor invalido o frames pineados) y lo explican por stderr.
+  bool resize(int new_frame_count);
+  bool setPolicy(const std::string &name);
+
+  // Activa o desactiva la E/S directa del disco y vuelve a cortar las arenas
+  // con la alineacion que corresponde. Si hay frames pineados deja el disco
+  // como estaba y devuelve false.
+  bool setDirectIO(bool enable);
+  int frameCount() const { return frame_count; }
+  std::string policyName() const;
+
+  // Warm set: flushAll guarda en <disco>/warm.set los bloques residentes
+  // (buffer_warm_order = recency | frequency) y, con buffer_warm_preload=1,
+  // preloadWarmSet los vuelve a cargar al arrancar en lotes de E/S. Devuelve
+  // cuantos bloques cargo.
+  void saveWarmSet() const;
+  int preloadWarmSet();
 
   void printStatus() const;
   void printHitRate() const;
 
 private:
+  static constexpr int WARM_BATCH = 32;
+
   Disk &disk;
+  std::string warm_path;
+  bool warm_by_frequency;
   int frame_count;
-  int current_time;
-  int clock_hand;
-  ReplacementPolicy replacement_policy;
-  int total_accesses = 0;
-  int cache_hits = 0;
-
-  std::vector<Frame> frames;
-  std::unordered_map<int, int> block_to_frame;
-
-  void loadBlock(int block_id, int frame_index);
-  int evictFrame();
-  int evictLRU();
-  int evictClock();
-
-  void printStatusLRU() const;
-  void printStatusClock() const;
+  std::vector<std::unique_ptr<BufferShard>> shards;
+
+  BufferShard &shardFor(int block_id) const;
+  bool reconfigure(int new_frame_count, ReplacementPolicy policy);
+  BufferCounters totals() const;
 };
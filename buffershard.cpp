@@ -0,0 +1,1492 @@
+#include "buffershard.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+bool parsePolicy(const std::string &name, ReplacementPolicy &policy) {
+  if (name == "lru") policy = LRU;
+  else if (name == "clock") policy = CLOCK;
+  else if (name == "2q") policy = TWO_Q;
+  else if (name == "lru2") policy = LRU_2;
+  else if (name == "arc") policy = ARC;
+  else return false;
+  return true;
+}
+
+BufferShard::BufferShard(Disk &disk_, IOScheduler &scheduler_, WriteAheadLog &wal_,
+                         int frame_count_, const std::string &policy, int shard_index_,
+                         int shard_count_)
+  : disk(disk_), scheduler(scheduler_), wal(wal_), frame_count(frame_count_),
+    current_time(0), clock_hand(0), shard_index(shard_index_), shard_count(shard_count_) {
+  if (!parsePolicy(policy, replacement_policy))
+    throw std::invalid_argument("Política de reemplazo no reconocida");
+  sizePolicy();
+
+  // Frame tiene un latch y no se puede mover: el vector se crea de una vez.
+  // Los datos van todos en la arena, asi un fallo no reserva memoria.
+  arena = makeArena(frame_count);
+  frames = std::vector<Frame>(frame_count);
+  for (int i = 0; i < frame_count; ++i)
+    resetFrame(i);
+  unpinned = frame_count;
+  for (int i = frame_count - 1; i >= 0; --i)
+    free_frames.push_back(i);
+
+  setPrefetchWindow(disk.intOption("prefetch_window", 8));
+
+  bgwriter_clean_pct = std::clamp(disk.intOption("bgwriter_clean_pct", 25), 0, 100);
+  bgwriter_max_pages = std::max(0, disk.intOption("bgwriter_max_pages", 16));
+  bgwriter_delay = std::chrono::milliseconds(std::max(0, disk.intOption("bgwriter_delay_ms", 200)));
+  last_trickle = std::chrono::steady_clock::now();
+  if (bgwriter_max_pages > 0 && bgwriter_clean_pct > 0)
+    bgwriter = std::make_unique<BackgroundWriter>(disk);
+}
+
+// Busca el bloque esperando cualquier lectura suya en curso. La de un fallo
+// se hace sin el latch del shard: el frame queda pineado y loading, y quien
+// pida el mismo bloque mientras tanto espera en load_cv y lo vuelve a buscar.
+// Una lectura anticipada en vuelo se trata igual: se espera sin el latch, se
+// retira su resultado y se vuelve a buscar el bloque.
+std::unordered_map<int, int>::iterator BufferShard::awaitBlock(ShardLock &lock, int block_id) {
+  auto it = block_to_frame.find(block_id);
+  while (it != block_to_frame.end() &&
+         (frames[it->second].loading || frames[it->second].prefetching)) {
+    if (frames[it->second].loading) {
+      load_cv.wait(lock);
+    } else {
+      // La copia mantiene vivo al Prefetcher si setPrefetchWindow lo cambia
+      std::shared_ptr<Prefetcher> in_flight = prefetcher;
+      lock.unlock();
+      in_flight->wait(block_id);
+      lock.lock();
+      reapPrefetches();
+    }
+    it = block_to_frame.find(block_id);
+  }
+  return it;
+}
+
+// Trae el bloque al pool si hace falta y devuelve su frame ya pineado, asi
+// prefetchAhead no lo puede elegir como victima
+int BufferShard::fetchFrame(ShardLock &lock, int block_id) {
+  ++total_accesses;
+  ++current_time;
+  reapPrefetches();
+
+  auto it = awaitBlock(lock, block_id);
+  if (it != block_to_frame.end()) {
+    ++cache_hits;
+    int frame_idx = it->second;
+    if (frames[frame_idx].prefetched) {
+      frames[frame_idx].prefetched = false;
+      ++prefetch_hits;
+    }
+    if (frames[frame_idx].warmed) {
+      frames[frame_idx].warmed = false;
+      ++warm_hits;
+    }
+    ++frames[frame_idx].uses;
+    touchFrame(frame_idx);
+    pinFrame(frame_idx);
+    prefetchAhead(block_id);
+    return frame_idx;
+  }
+
+  ScanState *scan = currentScan();
+  if (scan) {
+    std::vector<int> batch = scanBatchFor(*scan, block_id);
+    if (batch.size() > 1) {
+      loadBlocks(lock, batch, scan);
+      int frame_idx = block_to_frame.at(block_id);
+      ++frames[frame_idx].uses;
+      pinFrame(frame_idx);
+      prefetchAhead(block_id);
+      return frame_idx;
+    }
+  }
+
+  trickleDirty();
+  bool use_ring = scan && scan->use_ring && scan->blocks.indexOf(block_id) != -1;
+  int frame_idx = use_ring ? ringFrame(*scan, block_id) : evictFrame(block_id);
+
+  settleWrite(frame_idx);
+  writeVictim(frame_idx);
+  Frame &f = frames[frame_idx];
+  f.block_id = block_id;
+  f.dirty = false;
+  f.page_lsn = 0;
+  f.warmed = false;
+  f.loading = true;
+  f.pin_count = 1;
+  --unpinned;
+  block_to_frame[block_id] = frame_idx;
+
+  // Mientras dura la lectura el frame esta pineado: nadie lo desaloja y
+  // reconfigure no mueve el vector de frames
+  std::exception_ptr error;
+  lock.unlock();
+  try {
+    scheduler.readBlock(block_id, f.data);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  lock.lock();
+  load_cv.notify_all();
+
+  if (error) {
+    abandonLoad(frame_idx);
+    std::rethrow_exception(error);
+  }
+  // Sigue con el pin de la lectura; la politica lo recibe al soltarlo
+  f.loading = false;
+  f.time = current_time;
+  f.ref_bit = (replacement_policy == CLOCK);
+  f.uses = 1;
+  prefetchAhead(block_id);
+  return frame_idx;
+}
+
+// Trae y pinea bajo el mismo latch: entre los dos otro hilo podria desalojar
+// el bloque. El PageGuard guarda el frame y no vuelve a buscarlo.
+FrameRef BufferShard::fix(int block_id) {
+  ShardLock lock(shard_latch);
+  return fixLocked(lock, block_id);
+}
+
+// Como fix, pero un bloque que no esta en el pool se lee del mapeo si lo hay,
+// sin pin ni frame
+FrameRef BufferShard::fixView(int block_id) {
+  ShardLock lock(shard_latch);
+  if (block_to_frame.find(block_id) == block_to_frame.end()) {
+    const char *view = disk.blockView(block_id);
+    if (view) {
+      ++zero_copy_reads;
+      scheduler.recordAccess(block_id);
+      return {nullptr, -1, const_cast<char *>(view), disk.block_size, nullptr};
+    }
+  }
+  return fixLocked(lock, block_id);
+}
+
+// fetchFrame suelta el latch durante las lecturas, asi que lock tiene que ser
+// el unico nivel tomado del latch recursivo
+FrameRef BufferShard::fixLocked(ShardLock &lock, int block_id) {
+  int frame_idx = fetchFrame(lock, block_id);
+  Frame &f = frames[frame_idx];
+  return {this, frame_idx, f.data, disk.block_size, &f.latch};
+}
+
+// Suelta el pin de un guard y, si escribio, marca el frame con el LSN mayor
+void BufferShard::unfix(int frame_idx, bool dirty, uint64_t lsn) {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  Frame &f = frames[frame_idx];
+  if (dirty) {
+    f.dirty = true;
+    f.page_lsn = std::max(f.page_lsn, lsn);
+  }
+  unpinFrame(frame_idx);
+}
+
+void BufferShard::beginScan(const ExtentList &block_ids) {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  ScanState &scan = scans[std::this_thread::get_id()];
+  releaseRing(scan);
+  scan.blocks = block_ids;
+  scan.use_ring = (int)block_ids.size() / shard_count > frame_count / 4;
+}
+
+// Las lecturas anticipadas que sigan en vuelo no se esperan: su frame queda
+// pineado por ellas hasta que el proximo acceso al shard las retire
+void BufferShard::endScan() {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  reapPrefetches();
+  auto it = scans.find(std::this_thread::get_id());
+  if (it == scans.end()) return;
+  releaseRing(it->second);
+  scans.erase(it);
+}
+
+// Recorrido abierto por el hilo que llama, o nulo si no tiene ninguno
+BufferShard::ScanState *BufferShard::currentScan() {
+  auto it = scans.find(std::this_thread::get_id());
+  return it == scans.end() ? nullptr : &it->second;
+}
+
+// Devuelve block_id seguido de los proximos bloques del recorrido que no estan
+// en el pool, limitado por SCAN_BATCH y por los frames que se pueden desalojar
+std::vector<int> BufferShard::scanBatchFor(const ScanState &scan, int block_id) {
+  std::vector<int> batch{block_id};
+
+  int found = scan.blocks.indexOf(block_id);
+  if (found == -1) return batch;
+  size_t pos = found;
+
+  int limit = std::min({SCAN_BATCH, frame_count / 2, unpinned});
+  if (scan.use_ring) limit = std::min(limit, ring_size);
+
+  size_t end = std::min(scan.blocks.size(), pos + 1 + (size_t)limit * shard_count);
+  for (size_t i = pos + 1; i < end && (int)batch.size() < limit; ++i) {
+    int next = scan.blocks.at(i);
+    if (ownsBlock(next) && block_to_frame.count(next) == 0 &&
+        std::find(batch.begin(), batch.end(), next) == batch.end())
+      batch.push_back(next);
+  }
+  return batch;
+}
+
+// Carga varios bloques no residentes con una sola llamada a readBlocks. Los
+// frames elegidos quedan pineados mientras dura la carga para que el mismo
+// lote no se desaloje a si mismo. Las victimas sucias se escriben antes juntas,
+// con el latch, y recien cuando todas se confirmaron los frames pasan a los
+// bloques nuevos; si alguna falla, todas las victimas vuelven a su bloque. Las
+// lecturas se despachan sin el latch como en fetchFrame.
+void BufferShard::loadBlocks(ShardLock &lock, const std::vector<int> &block_ids,
+                             ScanState *scan) {
+  std::vector<int> targets;
+  std::vector<int> loads;
+  auto give_back = [&] {
+    for (int frame_idx : targets) {
+      frames[frame_idx].pin_count = 0;
+      ++unpinned;
+      restoreVictim(frame_idx);
+    }
+  };
+
+  // Hasta que se escriban, las victimas conservan su bloque y sus datos
+  uint64_t max_lsn = 0;
+  try {
+    for (int block_id : block_ids) {
+      if (block_to_frame.count(block_id)) continue;
+
+      int frame_idx = scan && scan->use_ring ? ringFrame(*scan, block_id) : evictFrame(block_id);
+      settleWrite(frame_idx);
+      Frame &f = frames[frame_idx];
+      f.pin_count = 1;
+      --unpinned;
+      targets.push_back(frame_idx);
+      loads.push_back(block_id);
+      if (f.dirty && f.block_id != -1) max_lsn = std::max(max_lsn, f.page_lsn);
+    }
+    wal.flushTo(max_lsn);
+  } catch (...) {
+    give_back();
+    throw;
+  }
+
+  std::vector<int> victims;
+  for (int frame_idx : targets) {
+    Frame &f = frames[frame_idx];
+    if (!f.dirty || f.block_id == -1) continue;
+    scheduler.submitWrite(f.block_id, f.data);
+    victims.push_back(frame_idx);
+  }
+  // Se despachan antes que las lecturas porque reutilizan los mismos buffers
+  std::vector<bool> written = scheduler.dispatch();
+  bool write_failed = false;
+  for (size_t i = 0; i < victims.size(); ++i) {
+    if (!written[i]) {
+      write_failed = true;
+      continue;
+    }
+    frames[victims[i]].dirty = false;
+    ++eviction_writes;
+  }
+  if (write_failed) {
+    give_back();
+    throw std::runtime_error("No se pudo escribir un bloque desalojado");
+  }
+
+  for (size_t i = 0; i < targets.size(); ++i) {
+    Frame &f = frames[targets[i]];
+    f.block_id = loads[i];
+    f.dirty = false;
+    f.page_lsn = 0;
+    f.uses = 0;
+    f.warmed = false;
+    f.loading = true;
+    block_to_frame[loads[i]] = targets[i];
+    scheduler.submitRead(f.block_id, f.data);
+  }
+  lock.unlock();
+  std::vector<bool> loaded = scheduler.dispatch();
+  lock.lock();
+  load_cv.notify_all();
+
+  bool failed = false;
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (!loaded[i]) {
+      abandonLoad(targets[i]);
+      failed = true;
+      continue;
+    }
+    Frame &f = frames[targets[i]];
+    f.loading = false;
+    f.time = current_time;
+    f.pin_count = 0;
+    ++unpinned;
+    f.ref_bit = (replacement_policy == CLOCK);
+    attachFrame(targets[i]);
+  }
+  if (failed)
+    throw std::runtime_error("No se pudieron leer todos los bloques del lote");
+}
+
+// Escribe la victima sucia de un fallo antes de reasignar su frame. Si la
+// escritura falla el frame vuelve a su bloque y el error sube sin perder datos.
+void BufferShard::writeVictim(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (!f.dirty || f.block_id == -1) return;
+  try {
+    wal.flushTo(f.page_lsn);
+    scheduler.writeBlock(f.block_id, f.data);
+  } catch (...) {
+    restoreVictim(frame_idx);
+    throw;
+  }
+  f.dirty = false;
+  ++eviction_writes;
+}
+
+// Deshace la eleccion de una victima sin pin que no se llego a reasignar: el
+// frame conserva su bloque y sus datos, sale del historial donde lo anoto el
+// desalojo y vuelve a ser candidato en la lista que le asigno la politica
+void BufferShard::restoreVictim(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (f.block_id == -1) {
+    if (!f.in_ring) releaseFrame(frame_idx);
+    return;
+  }
+  block_to_frame[f.block_id] = frame_idx;
+  a1out.erase(f.block_id);
+  arc_b1.erase(f.block_id);
+  arc_b2.erase(f.block_id);
+  if (lru2_history.erase(f.block_id)) lru2_history_time.erase(f.block_id);
+  attachFrame(frame_idx);
+}
+
+// Deshace la carga de un frame que tomo un fallo o un lote y no se pudo leer:
+// el bloque deja el pool y el frame vuelve a estar libre
+void BufferShard::abandonLoad(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  block_to_frame.erase(f.block_id);
+  f.block_id = -1;
+  f.loading = false;
+  f.pin_count = 0;
+  ++unpinned;
+  if (!f.in_ring) releaseFrame(frame_idx);
+}
+
+void BufferShard::pinFrame(int frame_idx) {
+  if (frames[frame_idx].pin_count++ == 0) {
+    --unpinned;
+    detachFrame(frame_idx);
+  }
+}
+
+void BufferShard::unpinFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (f.pin_count == 0)
+    throw std::runtime_error("Intento de unpin a un bloque no pineado");
+  if (--f.pin_count == 0) {
+    ++unpinned;
+    attachFrame(frame_idx);
+  }
+}
+
+// El bloque se libero en el bitmap: su frame se vacia sin escribirlo, asi una
+// version vieja no pisa despues a quien reciba el bloque (el checkpoint
+// escribe catalogo e indices directo al disco). Un frame pineado solo deja de
+// estar sucio.
+void BufferShard::discardBlock(int block_id) {
+  ShardLock lock(shard_latch);
+  auto it = awaitBlock(lock, block_id);
+  if (it == block_to_frame.end()) return;
+  int frame_idx = it->second;
+  settleWrite(frame_idx);
+  Frame &f = frames[frame_idx];
+  f.dirty = false;
+  if (f.pin_count > 0) return;
+
+  block_to_frame.erase(it);
+  forgetPrefetched(f);
+  f.block_id = -1;
+  f.page_lsn = 0;
+  f.warmed = false;
+  if (!f.in_ring) releaseFrame(frame_idx);
+}
+
+void BufferShard::flushBlock(int block_id) {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  auto it = block_to_frame.find(block_id);
+  if (it != block_to_frame.end()) {
+    int idx = it->second;
+    settleWrite(idx);
+    if (frames[idx].dirty) {
+      wal.flushTo(frames[idx].page_lsn);
+      scheduler.writeBlock(block_id, frames[idx].data);
+      frames[idx].dirty = false;
+    }
+  }
+}
+
+int BufferShard::dirtyCount() const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  return std::count_if(frames.begin(), frames.end(),
+                       [](const Frame &f) { return f.dirty; });
+}
+
+int BufferShard::hitCount() const { return cache_hits; }
+
+int BufferShard::accessCount() const { return total_accesses; }
+
+void BufferShard::flushAll() {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  if (bgwriter) {
+    bgwriter->drain();
+    reapWrites();
+  }
+
+  uint64_t max_lsn = 0;
+  for (const Frame &frame : frames)
+    if (frame.dirty) max_lsn = std::max(max_lsn, frame.page_lsn);
+  wal.flushTo(max_lsn);
+
+  std::vector<Frame *> dirty_frames;
+  for (Frame &frame : frames) {
+    if (frame.dirty && frame.block_id != -1) {
+      scheduler.submitWrite(frame.block_id, frame.data);
+      dirty_frames.push_back(&frame);
+    }
+  }
+
+  std::vector<bool> written = scheduler.dispatch();
+  int failed = 0;
+  for (size_t i = 0; i < dirty_frames.size(); ++i) {
+    if (written[i])
+      dirty_frames[i]->dirty = false;
+    else
+      ++failed;
+  }
+  if (failed > 0)
+    throw std::runtime_error("flushAll: no se pudieron escribir " +
+                             std::to_string(failed) + " bloques");
+}
+
+// Escribe los sucios y libera todos los frames no fijados. El historial de
+// bloques desalojados tambien se olvida para que el pool arranque en frio.
+void BufferShard::evictAll() {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  drainPrefetches();
+  flushAll();
+  for (int i = frame_count - 1; i >= 0; --i) {
+    Frame &frame = frames[i];
+    if (frame.block_id == -1 || frame.pin_count > 0 || frame.in_ring) continue;
+    // Primero sale de la politica: LRU-2 lo busca por (prev_time, time)
+    releaseFrame(i);
+    forgetPrefetched(frame);
+    block_to_frame.erase(frame.block_id);
+    frame.block_id = -1;
+    frame.time = -1;
+    frame.prev_time = 0;
+    frame.ref_bit = false;
+  }
+  clearHistory();
+}
+
+// block_id es el bloque que va a ocupar el frame: 2Q y ARC lo buscan en sus
+// listas fantasma para decidir la victima y la lista de destino
+int BufferShard::evictFrame(int block_id) {
+  switch (replacement_policy) {
+  case CLOCK: return evictClock();
+  case TWO_Q: return evict2Q(block_id);
+  case LRU_2: return evictLRU2(block_id);
+  case ARC: return evictARC(block_id);
+  default: break;
+  }
+  int idx = evictLRU();
+  assignQueue(idx, RECENT);
+  return idx;
+}
+
+void BufferShard::touchFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (f.in_ring) {
+    f.time = current_time;
+    return;
+  }
+  switch (replacement_policy) {
+  case CLOCK:
+    f.ref_bit = true;
+    break;
+  case LRU:
+    if (f.linked && queues[RECENT].tail != frame_idx) {
+      queueUnlink(frame_idx);
+      queuePushBack(frame_idx);
+    }
+    break;
+  case TWO_Q:
+    // A1in es FIFO: un segundo acceso mientras esta ahi no lo promueve
+    ++queue_hits[f.queue];
+    if (f.queue == FREQUENT && f.linked) {
+      queueUnlink(frame_idx);
+      queuePushBack(frame_idx);
+    }
+    break;
+  case ARC:
+    ++queue_hits[f.queue];
+    detachFrame(frame_idx);
+    if (f.queue == RECENT) {
+      --queues[RECENT].count;
+      f.queue = -1;
+      assignQueue(frame_idx, FREQUENT);
+    }
+    attachFrame(frame_idx);
+    break;
+  case LRU_2:
+    // Dos accesos seguidos al mismo bloque cuentan como una sola referencia
+    detachFrame(frame_idx);
+    if (f.time != current_time - 1) f.prev_time = f.time;
+    if (f.prev_time > 0) ++queue_hits[FREQUENT];
+    f.time = current_time;
+    attachFrame(frame_idx);
+    return;
+  }
+  f.time = current_time;
+}
+
+// O(1): un frame vacio si hay, si no la cabeza de la lista LRU
+int BufferShard::evictLRU() {
+  int idx = popFreeFrame();
+  if (idx != -1) return idx;
+  if (queues[RECENT].head == -1)
+    throw std::runtime_error("No se puede desalojar ningún frame (LRU)");
+
+  idx = queues[RECENT].head;
+  takeVictim(idx);
+  return idx;
+}
+
+// 2Q: mientras A1in supere kin se desaloja de ahi (y el bloque pasa a A1out);
+// si no, el menos reciente de Am. Un bloque que vuelve desde A1out entra a Am.
+int BufferShard::evict2Q(int block_id) {
+  int target = RECENT;
+  if (a1out.erase(block_id)) {
+    ++ghost_hits[RECENT];
+    target = FREQUENT;
+  }
+
+  int idx = popFreeFrame();
+  if (idx == -1) {
+    int from = queues[RECENT].count > kin ? RECENT : FREQUENT;
+    if (queues[from].head == -1) from = 1 - from;
+    if (queues[from].head == -1)
+      throw std::runtime_error("No se puede desalojar ningún frame (2Q)");
+
+    idx = queues[from].head;
+    if (from == RECENT) {
+      a1out.push(frames[idx].block_id);
+      if (a1out.size() > kout) a1out.popFront();
+    }
+    takeVictim(idx);
+  }
+  assignQueue(idx, target);
+  return idx;
+}
+
+// LRU-2: victima = mayor distancia al penultimo acceso. Los que tienen una sola
+// referencia van primero, entre ellos por LRU.
+int BufferShard::evictLRU2(int block_id) {
+  int idx = popFreeFrame();
+  if (idx == -1) {
+    if (lru2_order.empty())
+      throw std::runtime_error("No se puede desalojar ningún frame (LRU-2)");
+
+    idx = std::get<2>(*lru2_order.begin());
+    int victim = frames[idx].block_id;
+    lru2_history.push(victim);
+    lru2_history_time[victim] = frames[idx].time;
+    if (lru2_history.size() > frame_count)
+      lru2_history_time.erase(lru2_history.popFront());
+    takeVictim(idx);
+  }
+
+  frames[idx].prev_time = 0;
+  if (lru2_history.erase(block_id)) {
+    ++ghost_hits[RECENT];
+    frames[idx].prev_time = lru2_history_time[block_id];
+    lru2_history_time.erase(block_id);
+  }
+  return idx;
+}
+
+// ARC segun Megiddo y Modha: un acierto en B1 agranda el objetivo de T1, uno
+// en B2 lo achica. Con frames vacios no hace falta REPLACE.
+int BufferShard::evictARC(int block_id) {
+  int c = frame_count;
+  int target = FREQUENT;
+  bool in_b2 = false;
+  bool from_t1 = false;
+
+  if (arc_b1.contains(block_id)) {
+    ++ghost_hits[RECENT];
+    arc_p = std::min(c, arc_p + std::max(arc_b2.size() / arc_b1.size(), 1));
+    arc_b1.erase(block_id);
+  } else if (arc_b2.contains(block_id)) {
+    ++ghost_hits[FREQUENT];
+    arc_p = std::max(0, arc_p - std::max(arc_b1.size() / arc_b2.size(), 1));
+    arc_b2.erase(block_id);
+    in_b2 = true;
+  } else {
+    target = RECENT;
+    int l1 = queues[RECENT].count + arc_b1.size();
+    if (l1 >= c) {
+      if (arc_b1.size() > 0) arc_b1.popFront();
+      else from_t1 = true;
+    } else if (l1 + queues[FREQUENT].count + arc_b2.size() >= 2 * c &&
+               arc_b2.size() > 0) {
+      arc_b2.popFront();
+    }
+  }
+
+  int idx = popFreeFrame();
+  if (idx == -1) idx = arcReplace(in_b2, from_t1);
+  assignQueue(idx, target);
+  return idx;
+}
+
+// REPLACE de ARC. from_t1 fuerza desalojar de T1 sin dejar fantasma (caso en
+// que T1 ocupa todo el pool). Si la lista elegida solo tiene frames pineados
+// se usa la otra.
+int BufferShard::arcReplace(bool in_b2, bool from_t1) {
+  int t1 = queues[RECENT].count;
+  int from = FREQUENT;
+  if (from_t1 || (t1 >= 1 && ((in_b2 && t1 == arc_p) || t1 > arc_p)))
+    from = RECENT;
+  if (queues[from].head == -1) from = 1 - from;
+  if (queues[from].head == -1)
+    throw std::runtime_error("No se puede desalojar ningún frame (ARC)");
+
+  int idx = queues[from].head;
+  if (!from_t1) {
+    GhostList &ghosts = (from == RECENT) ? arc_b1 : arc_b2;
+    ghosts.push(frames[idx].block_id);
+    if (ghosts.size() > frame_count) ghosts.popFront();
+  }
+  takeVictim(idx);
+  return idx;
+}
+
+int BufferShard::popFreeFrame() {
+  if (free_frames.empty()) return -1;
+  int idx = free_frames.back();
+  free_frames.pop_back();
+  return idx;
+}
+
+// Frame para un bloque del recorrido. Mientras el anillo no esta completo se
+// toma uno del pool con la politica normal; despues se reutilizan los del
+// anillo en orden. Si el que toca sigue pineado, vuelve a la politica y se
+// reemplaza por otro del pool.
+int BufferShard::ringFrame(ScanState &scan, int block_id) {
+  int slot = -1;
+  if ((int)scan.ring.size() == ring_size) {
+    slot = scan.ring_pos;
+    scan.ring_pos = (scan.ring_pos + 1) % ring_size;
+    int idx = scan.ring[slot];
+    if (frames[idx].pin_count == 0) {
+      forgetPrefetched(frames[idx]);
+      if (frames[idx].block_id != -1) block_to_frame.erase(frames[idx].block_id);
+      ++ring_reuses;
+      return idx;
+    }
+    leaveRing(idx);
+  }
+
+  int idx = evictFrame(block_id);
+  Frame &f = frames[idx];
+  if (f.queue != -1) --queues[f.queue].count;
+  f.queue = -1;
+  f.in_ring = true;
+  if (slot == -1) scan.ring.push_back(idx);
+  else scan.ring[slot] = idx;
+  return idx;
+}
+
+// El frame deja el anillo y vuelve a la politica como el primer candidato a
+// victima: lo que se leyo en un recorrido no deberia desplazar a nadie
+void BufferShard::leaveRing(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  f.in_ring = false;
+  if (f.block_id == -1) {
+    releaseFrame(frame_idx);
+    return;
+  }
+  switch (replacement_policy) {
+  case CLOCK:
+    f.ref_bit = false;
+    break;
+  case LRU_2:
+    f.prev_time = 0;
+    attachFrame(frame_idx);
+    break;
+  default:
+    assignQueue(frame_idx, RECENT);
+    if (f.pin_count == 0) queuePushFront(frame_idx);
+    break;
+  }
+}
+
+void BufferShard::releaseRing(ScanState &scan) {
+  for (int idx : scan.ring)
+    leaveRing(idx);
+  scan.ring.clear();
+  scan.ring_pos = 0;
+}
+
+int BufferShard::prefetchWindow() const { return prefetch_window; }
+
+bool BufferShard::prefetchEnabled() const { return prefetcher != nullptr; }
+
+void BufferShard::setPrefetchWindow(int window) {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  drainPrefetches();
+  reapPrefetches();
+  prefetch_window = std::max(0, window);
+  // Con mmap los recorridos leen del mapeo y no hay nada que adelantar
+  if (prefetch_window > 0 && disk.backend != BACKEND_MMAP) {
+    if (!prefetcher) prefetcher = std::make_shared<Prefetcher>(disk);
+  } else {
+    prefetcher.reset();
+  }
+}
+
+// Encola los proximos bloques no residentes de la ventana. En el anillo la
+// ventana deja libre el slot que se va a reutilizar; fuera de el no se toma
+// mas de la mitad de los frames sin pin, como en scanBatchFor.
+void BufferShard::prefetchAhead(int block_id) {
+  ScanState *scan = prefetcher ? currentScan() : nullptr;
+  if (!scan) return;
+  int found = scan->blocks.indexOf(block_id);
+  if (found == -1) return;
+
+  int window = prefetch_window;
+  if (scan->use_ring) window = std::min(window, ring_size - 1);
+
+  size_t end = std::min(scan->blocks.size(), static_cast<size_t>(found) + 1 + window);
+  for (size_t i = found + 1; i < end; ++i) {
+    int next = scan->blocks.at(i);
+    if (!ownsBlock(next) || block_to_frame.count(next)) continue;
+    if (!scan->use_ring && unpinned - frame_count / 2 <= 0) return;
+
+    int frame_idx = scan->use_ring ? ringFrame(*scan, next) : evictFrame(next);
+    settleWrite(frame_idx);
+    // El bloque pedido ya esta pineado por el llamador: un error aca solo
+    // corta la ventana, el frame volvio a su bloque
+    try {
+      writeVictim(frame_idx);
+    } catch (const std::exception &e) {
+      std::cerr << "Prefetch detenido: " << e.what() << std::endl;
+      return;
+    }
+    Frame &f = frames[frame_idx];
+    f.block_id = next;
+    f.dirty = false;
+    f.time = current_time;
+    f.pin_count = 1;
+    --unpinned;
+    f.ref_bit = (replacement_policy == CLOCK);
+    f.page_lsn = 0;
+    f.uses = 0;
+    f.warmed = false;
+    f.prefetching = true;
+    block_to_frame[next] = frame_idx;
+    scheduler.recordAccess(next);
+    prefetcher->submit(next, f.data);
+    ++prefetch_issued;
+  }
+}
+
+// Una lectura anticipada termino: suelta el pin que la protegia. Si fallo el
+// frame se vacia y el proximo acceso lee el bloque de forma normal.
+void BufferShard::finishPrefetch(int frame_idx, bool ok) {
+  Frame &f = frames[frame_idx];
+  f.prefetching = false;
+  if (--f.pin_count == 0) ++unpinned;
+  if (ok) {
+    f.prefetched = true;
+    attachFrame(frame_idx);
+    return;
+  }
+  block_to_frame.erase(f.block_id);
+  f.block_id = -1;
+  if (!f.in_ring && f.pin_count == 0) releaseFrame(frame_idx);
+}
+
+void BufferShard::reapPrefetches() {
+  if (!prefetcher) return;
+  for (auto [block_id, ok] : prefetcher->takeCompleted()) {
+    auto it = block_to_frame.find(block_id);
+    if (it != block_to_frame.end() && frames[it->second].prefetching)
+      finishPrefetch(it->second, ok);
+  }
+}
+
+void BufferShard::drainPrefetches() {
+  if (!prefetcher) return;
+  prefetcher->drain();
+  reapPrefetches();
+}
+
+// El frame deja de tener su bloque: si nadie lo habia pedido, se adelanto de mas
+void BufferShard::forgetPrefetched(Frame &f) {
+  if (!f.prefetched) return;
+  f.prefetched = false;
+  ++prefetch_wasted;
+}
+
+void BufferShard::trickleDirty() {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  if (!bgwriter) return;
+  reapWrites();
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_trickle < bgwriter_delay) return;
+  last_trickle = now;
+
+  int max_dirty = frame_count - frame_count * bgwriter_clean_pct / 100;
+  int dirty = dirtyCount();
+  if (dirty <= max_dirty) return;
+
+  std::vector<int> candidates;
+  for (int i = 0; i < frame_count; ++i) {
+    const Frame &f = frames[i];
+    if (f.dirty && !f.cleaning && f.pin_count == 0 && f.block_id != -1)
+      candidates.push_back(i);
+  }
+  int count = std::min({dirty - max_dirty, bgwriter_max_pages, (int)candidates.size()});
+  if (count == 0) return;
+  std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                    [&](int a, int b) { return frames[a].time < frames[b].time; });
+  candidates.resize(count);
+
+  uint64_t max_lsn = 0;
+  for (int idx : candidates) max_lsn = std::max(max_lsn, frames[idx].page_lsn);
+  wal.flushTo(max_lsn);
+
+  // El frame queda limpio ya: si se vuelve a modificar, markDirty lo ensucia
+  // otra vez y la copia en vuelo solo adelanta una version anterior
+  for (int idx : candidates) {
+    Frame &f = frames[idx];
+    scheduler.recordAccess(f.block_id);
+    bgwriter->submit(f.block_id, f.data);
+    f.dirty = false;
+    f.cleaning = true;
+  }
+  ++bg_rounds;
+  bg_writes += count;
+}
+
+// Antes de desalojar o escribir un frame se espera su escritura de fondo,
+// para que no se pise con una lectura o escritura posterior del bloque. Si
+// fallo, el frame vuelve a estar sucio.
+void BufferShard::settleWrite(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (!f.cleaning) return;
+  f.cleaning = false;
+  if (!bgwriter->waitFor(f.block_id)) f.dirty = true;
+}
+
+void BufferShard::reapWrites() {
+  for (auto [block_id, ok] : bgwriter->takeCompleted()) {
+    auto it = block_to_frame.find(block_id);
+    if (it == block_to_frame.end()) continue;
+    Frame &f = frames[it->second];
+    if (!f.cleaning) continue;
+    f.cleaning = false;
+    if (!ok) f.dirty = true;
+  }
+}
+
+// Saca del pool al bloque de un frame elegido como victima
+void BufferShard::takeVictim(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  detachFrame(frame_idx);
+  if (f.queue != -1) --queues[f.queue].count;
+  f.queue = -1;
+  forgetPrefetched(f);
+  block_to_frame.erase(f.block_id);
+}
+
+void BufferShard::queueUnlink(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  FrameQueue &q = queues[f.queue];
+  if (f.lru_prev != -1) frames[f.lru_prev].lru_next = f.lru_next;
+  else q.head = f.lru_next;
+  if (f.lru_next != -1) frames[f.lru_next].lru_prev = f.lru_prev;
+  else q.tail = f.lru_prev;
+  f.lru_prev = f.lru_next = -1;
+  f.linked = false;
+}
+
+void BufferShard::queuePushBack(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  FrameQueue &q = queues[f.queue];
+  f.lru_prev = q.tail;
+  f.lru_next = -1;
+  if (q.tail != -1) frames[q.tail].lru_next = frame_idx;
+  else q.head = frame_idx;
+  q.tail = frame_idx;
+  f.linked = true;
+}
+
+void BufferShard::queuePushFront(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  FrameQueue &q = queues[f.queue];
+  f.lru_prev = -1;
+  f.lru_next = q.head;
+  if (q.head != -1) frames[q.head].lru_prev = frame_idx;
+  else q.tail = frame_idx;
+  q.head = frame_idx;
+  f.linked = true;
+}
+
+void BufferShard::assignQueue(int frame_idx, int queue) {
+  frames[frame_idx].queue = queue;
+  ++queues[queue].count;
+}
+
+// Un frame ocupado y sin pin pasa a ser candidato a victima
+void BufferShard::attachFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (f.linked || f.in_ring || f.pin_count > 0 || f.block_id == -1) return;
+  if (replacement_policy == LRU_2) {
+    lru2_order.insert({f.prev_time, f.time, frame_idx});
+    f.linked = true;
+  } else if (f.queue != -1) {
+    queuePushBack(frame_idx);
+  }
+}
+
+void BufferShard::detachFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  if (!f.linked) return;
+  if (replacement_policy == LRU_2) {
+    lru2_order.erase({f.prev_time, f.time, frame_idx});
+    f.linked = false;
+  } else {
+    queueUnlink(frame_idx);
+  }
+}
+
+// Los frames vacios no se usan con Clock; los encuentra con la aguja
+void BufferShard::releaseFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  detachFrame(frame_idx);
+  if (f.queue != -1) --queues[f.queue].count;
+  f.queue = -1;
+  if (replacement_policy != CLOCK) free_frames.push_back(frame_idx);
+}
+
+// Tamaños que dependen del pool
+void BufferShard::sizePolicy() {
+  // Valores del articulo de 2Q: A1in un 25% del pool, A1out la mitad
+  kin = std::max(1, frame_count / 4);
+  kout = std::max(1, frame_count / 2);
+  // Como en PostgreSQL: el anillo no pasa de un octavo del pool
+  ring_size = std::max(1, std::min(SCAN_RING, frame_count / 8));
+}
+
+void BufferShard::resetFrame(int frame_idx) {
+  Frame &f = frames[frame_idx];
+  f.block_id = -1;
+  f.dirty = false;
+  f.time = -1;
+  f.prev_time = 0;
+  f.pin_count = 0;
+  f.ref_bit = false;
+  f.page_lsn = 0;
+  f.uses = 0;
+  f.warmed = false;
+  f.data = arena->frame(frame_idx);
+}
+
+bool BufferShard::reconfigure(int new_count, ReplacementPolicy policy) {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  if (hasPinnedFrames()) return false;
+  if (bgwriter) {
+    bgwriter->drain();
+    reapWrites();
+  }
+  for (auto &[thread_id, scan] : scans) releaseRing(scan);
+  scans.clear();
+
+  std::vector<int> resident;
+  for (int i = 0; i < frame_count; ++i)
+    if (frames[i].block_id != -1) resident.push_back(i);
+  std::sort(resident.begin(), resident.end(),
+            [&](int a, int b) { return frames[a].time > frames[b].time; });
+  size_t kept = std::min(resident.size(), static_cast<size_t>(new_count));
+
+  // Los que no entran se escriben antes de tocar nada: si falla, el pool queda
+  // como estaba
+  std::vector<int> dirty_dropped;
+  uint64_t max_lsn = 0;
+  for (size_t i = kept; i < resident.size(); ++i) {
+    const Frame &f = frames[resident[i]];
+    if (!f.dirty) continue;
+    dirty_dropped.push_back(resident[i]);
+    max_lsn = std::max(max_lsn, f.page_lsn);
+  }
+  if (!dirty_dropped.empty()) {
+    wal.flushTo(max_lsn);
+    for (int idx : dirty_dropped) scheduler.submitWrite(frames[idx].block_id, frames[idx].data);
+    std::vector<bool> written = scheduler.dispatch();
+    for (size_t i = 0; i < written.size(); ++i) {
+      if (!written[i])
+        throw std::runtime_error("No se pudo escribir el bloque " +
+                                 std::to_string(frames[dirty_dropped[i]].block_id));
+      frames[dirty_dropped[i]].dirty = false;
+    }
+    eviction_writes += static_cast<int>(dirty_dropped.size());
+  }
+  bool same_policy = policy == replacement_policy;
+  for (size_t i = kept; i < resident.size(); ++i) {
+    forgetPrefetched(frames[resident[i]]);
+    if (same_policy) rememberEvicted(frames[resident[i]]);
+  }
+  resident.resize(kept);
+  std::reverse(resident.begin(), resident.end());
+
+  // Los que se quedan ocupan los primeros frames, del mas antiguo al mas nuevo
+  auto new_arena = makeArena(new_count);
+  std::vector<Frame> new_frames(new_count);
+  std::vector<int> old_queue(kept, -1);
+  for (size_t i = 0; i < kept; ++i) {
+    const Frame &old = frames[resident[i]];
+    Frame &f = new_frames[i];
+    f.block_id = old.block_id;
+    f.dirty = old.dirty;
+    f.time = old.time;
+    f.prev_time = same_policy ? old.prev_time : 0;
+    f.pin_count = 0;
+    f.ref_bit = same_policy && old.ref_bit;
+    f.page_lsn = old.page_lsn;
+    f.prefetched = old.prefetched;
+    f.warmed = old.warmed;
+    f.uses = old.uses;
+    f.data = new_arena->frame(i);
+    std::memcpy(f.data, old.data, disk.block_size);
+    if (same_policy) old_queue[i] = old.queue;
+  }
+
+  frames = std::move(new_frames);
+  arena = std::move(new_arena);
+  frame_count = new_count;
+  unpinned = new_count;
+  replacement_policy = policy;
+  sizePolicy();
+  for (int i = kept; i < frame_count; ++i) resetFrame(i);
+
+  block_to_frame.clear();
+  queues[RECENT] = queues[FREQUENT] = FrameQueue();
+  free_frames.clear();
+  lru2_order.clear();
+  if (same_policy) trimHistory();
+  else clearHistory();
+  clock_hand = 0;
+  for (size_t i = 0; i < kept; ++i) {
+    block_to_frame[frames[i].block_id] = i;
+    if (replacement_policy != CLOCK && replacement_policy != LRU_2)
+      assignQueue(i, old_queue[i] != -1 ? old_queue[i] : RECENT);
+    attachFrame(i);
+  }
+  for (int i = frame_count - 1; i >= static_cast<int>(kept); --i)
+    free_frames.push_back(i);
+  return true;
+}
+
+std::unique_lock<std::recursive_mutex> BufferShard::lockShard() const {
+  return std::unique_lock<std::recursive_mutex>(shard_latch);
+}
+
+// Las lecturas anticipadas pinean su frame: se esperan antes de mirar
+bool BufferShard::hasPinnedFrames() {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  drainPrefetches();
+  return unpinned < frame_count;
+}
+
+std::vector<int> BufferShard::warmSet(bool by_frequency) const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  std::vector<int> resident;
+  for (int i = 0; i < frame_count; ++i)
+    if (frames[i].block_id != -1 && !frames[i].in_ring && !frames[i].prefetching)
+      resident.push_back(i);
+  std::sort(resident.begin(), resident.end(), [&](int a, int b) {
+    const Frame &fa = frames[a];
+    const Frame &fb = frames[b];
+    if (by_frequency && fa.uses != fb.uses) return fa.uses > fb.uses;
+    return fa.time > fb.time;
+  });
+  std::vector<int> blocks;
+  for (int idx : resident) blocks.push_back(frames[idx].block_id);
+  return blocks;
+}
+
+// Se cargan del mas frio al mas caliente, asi el mas caliente queda como el
+// usado mas recientemente
+int BufferShard::preload(const std::vector<int> &block_ids) {
+  ShardLock lock(shard_latch);
+  int empty = std::count_if(frames.begin(), frames.end(),
+                            [](const Frame &f) { return f.block_id == -1 && !f.in_ring; });
+  std::vector<int> batch;
+  for (int block_id : block_ids) {
+    if ((int)batch.size() == empty) break;
+    if (ownsBlock(block_id) && !block_to_frame.count(block_id) &&
+        std::find(batch.begin(), batch.end(), block_id) == batch.end())
+      batch.push_back(block_id);
+  }
+  if (batch.empty()) return 0;
+  std::reverse(batch.begin(), batch.end());
+
+  ++current_time;
+  loadBlocks(lock, batch, nullptr);
+  for (int block_id : batch) frames[block_to_frame.at(block_id)].warmed = true;
+  warm_loaded += static_cast<int>(batch.size());
+  return static_cast<int>(batch.size());
+}
+
+// La alineacion sale del modo de E/S del momento; BufferManager::setDirectIO
+// reconfigura el pool para volver a cortar la arena cuando cambia
+std::unique_ptr<FrameArena> BufferShard::makeArena(int count) const {
+  size_t alignment = disk.directIO() ? IO_ALIGNMENT : FrameArena::CACHE_LINE;
+  return std::make_unique<FrameArena>(count, disk.block_size, alignment,
+                                      disk.intOption("buffer_huge_pages", 0) != 0);
+}
+
+bool BufferShard::ownsBlock(int block_id) const {
+  return shardOfBlock(block_id, shard_count) == shard_index;
+}
+
+BufferCounters BufferShard::counters() const {
+  BufferCounters c;
+  c.accesses = total_accesses;
+  c.hits = cache_hits;
+  c.zero_copy_reads = zero_copy_reads;
+  c.ring_reuses = ring_reuses;
+  c.prefetch_issued = prefetch_issued;
+  c.prefetch_hits = prefetch_hits;
+  c.prefetch_wasted = prefetch_wasted;
+  c.bg_rounds = bg_rounds;
+  c.bg_writes = bg_writes;
+  c.eviction_writes = eviction_writes;
+  c.warm_loaded = warm_loaded;
+  c.warm_hits = warm_hits;
+  return c;
+}
+
+void BufferShard::clearHistory() {
+  a1out.clear();
+  arc_b1.clear();
+  arc_b2.clear();
+  arc_p = 0;
+  lru2_history.clear();
+  lru2_history_time.clear();
+}
+
+// Lo que la politica recuerda de un bloque que sale del pool, como en su
+// desalojo normal: A1out para 2Q, B1/B2 para ARC, el ultimo acceso para LRU-2
+void BufferShard::rememberEvicted(const Frame &f) {
+  switch (replacement_policy) {
+  case TWO_Q:
+    if (f.queue == RECENT) a1out.push(f.block_id);
+    break;
+  case ARC:
+    (f.queue == RECENT ? arc_b1 : arc_b2).push(f.block_id);
+    break;
+  case LRU_2:
+    lru2_history.push(f.block_id);
+    lru2_history_time[f.block_id] = f.time;
+    break;
+  default:
+    break;
+  }
+}
+
+// Deja el historial dentro de los limites del tamaño actual del pool
+void BufferShard::trimHistory() {
+  while (a1out.size() > kout) a1out.popFront();
+  while (arc_b1.size() > frame_count) arc_b1.popFront();
+  while (arc_b2.size() > frame_count) arc_b2.popFront();
+  arc_p = std::min(arc_p, frame_count);
+  while (lru2_history.size() > frame_count) lru2_history_time.erase(lru2_history.popFront());
+}
+
+bool GhostList::contains(int block_id) const { return pos.count(block_id) > 0; }
+
+void GhostList::push(int block_id) {
+  erase(block_id);
+  pos[block_id] = order.insert(order.end(), block_id);
+}
+
+bool GhostList::erase(int block_id) {
+  auto it = pos.find(block_id);
+  if (it == pos.end()) return false;
+  order.erase(it->second);
+  pos.erase(it);
+  return true;
+}
+
+int GhostList::popFront() {
+  int block_id = order.front();
+  pos.erase(block_id);
+  order.pop_front();
+  return block_id;
+}
+
+int GhostList::size() const { return static_cast<int>(order.size()); }
+
+void GhostList::clear() {
+  order.clear();
+  pos.clear();
+}
+
+int BufferShard::evictClock() {
+  int scanned = 0;
+  while (scanned < frame_count * 2) {
+    Frame &f = frames[clock_hand];
+    if (f.pin_count == 0 && !f.in_ring) {
+      if (!f.ref_bit) {
+        int evict_idx = clock_hand;
+        forgetPrefetched(f);
+        if (f.block_id != -1)
+          block_to_frame.erase(f.block_id);
+        clock_hand = (clock_hand + 1) % frame_count;
+        return evict_idx;
+      } else {
+        f.ref_bit = false;
+      }
+    }
+    clock_hand = (clock_hand + 1) % frame_count;
+    scanned++;
+  }
+
+  throw std::runtime_error("No se puede desalojar ningún frame (Clock)");
+}
+
+int BufferShard::frameCount() const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  return frame_count;
+}
+
+ReplacementPolicy BufferShard::replacementPolicy() const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  return replacement_policy;
+}
+
+std::string BufferShard::policyName() const {
+  switch (replacement_policy) {
+  case CLOCK: return "Clock";
+  case TWO_Q: return "2Q";
+  case LRU_2: return "LRU-2";
+  case ARC: return "ARC";
+  default: return "LRU";
+  }
+}
+
+void BufferShard::printStatus() const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  std::cout << "=== Estado del Buffer Manager (" 
+            << policyName()
+            << ") ===\n";
+  if (arena->pageKind() != FrameArena::PAGES_NORMAL || disk.intOption("buffer_huge_pages", 0) != 0)
+    std::cout << "Arena: " << arena->bytes() / 1024 << " KiB, " << arena->frameStride()
+              << " B por frame, paginas " << arena->pageKindName() << "\n";
+  if (replacement_policy == LRU)
+    printStatusLRU();
+  else if (replacement_policy == CLOCK)
+    printStatusClock();
+  else if (replacement_policy == LRU_2)
+    printStatusLRU2();
+  else
+    printStatusQueues();
+  printHitRate();
+}
+
+void BufferShard::printStatusLRU() const {
+  const int w_idx = 8, w_block = 10, w_dirty = 8, w_time = 10, w_pincnt = 10;
+
+  std::cout << std::left
+            << std::setw(w_idx) << "Indice"
+            << std::setw(w_block) << "Bloque"
+            << std::setw(w_dirty) << "Dirty"
+            << std::right
+            << std::setw(w_time) << "Tiempo"
+            << std::setw(w_pincnt) << "PinCount"
+            << '\n';
+
+  std::cout << std::string(w_idx + w_block + w_dirty + w_time + w_pincnt, '-') << "\n";
+
+  for (int i = 0; i < frame_count; ++i) {
+    const Frame &f = frames[i];
+    std::cout << std::left
+              << std::setw(w_idx) << i
+              << std::setw(w_block) << f.block_id
+              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
+              << std::right
+              << std::setw(w_time) << f.time
+              << std::setw(w_pincnt) << f.pin_count
+              << '\n';
+  }
+}
+
+void BufferShard::printStatusClock() const {
+  const int w_idx = 8, w_block = 10, w_dirty = 8, w_refbit = 10, w_pincnt = 10;
+
+  std::cout << std::left
+            << std::setw(w_idx) << "Indice"
+            << std::setw(w_block) << "Bloque"
+            << std::setw(w_dirty) << "Dirty"
+            << std::setw(w_refbit) << "RefBit"
+            << std::right
+            << std::setw(w_pincnt) << "PinCount"
+            << '\n';
+
+  std::cout << std::string(w_idx + w_block + w_dirty + w_refbit + w_pincnt, '-') << "\n";
+
+  for (int i = 0; i < frame_count; ++i) {
+    const Frame &f = frames[i];
+    std::cout << std::left
+              << std::setw(w_idx) << i
+              << std::setw(w_block) << f.block_id
+              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
+              << std::setw(w_refbit) << (f.ref_bit ? "1" : "0")
+              << std::right
+              << std::setw(w_pincnt) << f.pin_count;
+
+    if (i == clock_hand)
+      std::cout << "  <--- reloj";
+
+    std::cout << '\n';
+  }
+}
+
+// 2Q y ARC: cada frame con la lista en la que esta
+void BufferShard::printStatusQueues() const {
+  const int w_idx = 8, w_block = 10, w_dirty = 8, w_queue = 10, w_pincnt = 10;
+  const char *names[2] = {"T1", "T2"};
+  if (replacement_policy == TWO_Q) {
+    names[RECENT] = "A1in";
+    names[FREQUENT] = "Am";
+  }
+
+  std::cout << std::left
+            << std::setw(w_idx) << "Indice"
+            << std::setw(w_block) << "Bloque"
+            << std::setw(w_dirty) << "Dirty"
+            << std::setw(w_queue) << "Lista"
+            << std::right
+            << std::setw(w_pincnt) << "PinCount"
+            << '\n';
+
+  std::cout << std::string(w_idx + w_block + w_dirty + w_queue + w_pincnt, '-') << "\n";
+
+  for (int i = 0; i < frame_count; ++i) {
+    const Frame &f = frames[i];
+    std::cout << std::left
+              << std::setw(w_idx) << i
+              << std::setw(w_block) << f.block_id
+              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
+              << std::setw(w_queue) << (f.queue == -1 ? "-" : names[f.queue])
+              << std::right
+              << std::setw(w_pincnt) << f.pin_count
+              << '\n';
+  }
+
+  std::cout << '\n';
+  if (replacement_policy == TWO_Q) {
+    std::cout << "A1in: " << queues[RECENT].count << " (objetivo " << kin << ")"
+              << "  Am: " << queues[FREQUENT].count
+              << "  A1out: " << a1out.size() << "/" << kout << "\n";
+  } else {
+    std::cout << "T1: " << queues[RECENT].count << " (objetivo p=" << arc_p << ")"
+              << "  T2: " << queues[FREQUENT].count
+              << "  B1: " << arc_b1.size() << "  B2: " << arc_b2.size() << "\n";
+  }
+}
+
+void BufferShard::printStatusLRU2() const {
+  const int w_idx = 8, w_block = 10, w_dirty = 8, w_time = 10, w_prev = 12, w_pincnt = 10;
+
+  std::cout << std::left
+            << std::setw(w_idx) << "Indice"
+            << std::setw(w_block) << "Bloque"
+            << std::setw(w_dirty) << "Dirty"
+            << std::right
+            << std::setw(w_time) << "Ultimo"
+            << std::setw(w_prev) << "Penultimo"
+            << std::setw(w_pincnt) << "PinCount"
+            << '\n';
+
+  std::cout << std::string(w_idx + w_block + w_dirty + w_time + w_prev + w_pincnt, '-')
+            << "\n";
+
+  for (int i = 0; i < frame_count; ++i) {
+    const Frame &f = frames[i];
+    std::cout << std::left
+              << std::setw(w_idx) << i
+              << std::setw(w_block) << f.block_id
+              << std::setw(w_dirty) << (f.dirty ? "Si" : "No")
+              << std::right
+              << std::setw(w_time) << f.time
+              << std::setw(w_prev) << (f.prev_time > 0 ? std::to_string(f.prev_time) : "-")
+              << std::setw(w_pincnt) << f.pin_count
+              << '\n';
+  }
+
+  std::cout << "\nHistorial retenido: " << lru2_history.size() << " bloques\n";
+}
+
+void BufferShard::printHitRate() const {
+  std::lock_guard<std::recursive_mutex> lock(shard_latch);
+  std::cout << "\n=== Estadísticas de Hitrate ===\n";
+  std::cout << "Accesos totales: " << total_accesses << "\n";
+  std::cout << "Hits de caché  : " << cache_hits << "\n";
+  if (zero_copy_reads > 0)
+    std::cout << "Lecturas mmap  : " << zero_copy_reads << "\n";
+  if (ring_reuses > 0)
+    std::cout << "Reusos anillo  : " << ring_reuses << "\n";
+  if (bg_writes > 0 || eviction_writes > 0)
+    std::cout << "Escritura fondo: " << bg_writes << " en " << bg_rounds << " rondas, "
+              << eviction_writes << " al desalojar\n";
+  if (prefetch_issued > 0)
+    std::cout << "Prefetch       : " << prefetch_issued << " leidos, " << prefetch_hits
+              << " usados, " << prefetch_wasted << " desperdiciados\n";
+  if (total_accesses > 0) {
+    double hitrate = 100.0 * cache_hits / total_accesses;
+    std::cout << std::fixed << std::setprecision(2)
+              << "Hitrate        : " << hitrate << "%\n";
+    if (warm_loaded > 0)
+      std::cout << "Precarga       : " << warm_loaded << " bloques, " << warm_hits
+                << " fallos evitados (hitrate sin precarga "
+                << 100.0 * (cache_hits - warm_hits) / total_accesses << "%)\n";
+  } else {
+    std::cout << "Hitrate        : N/A (sin accesos)\n";
+  }
+
+  if (replacement_policy == TWO_Q) {
+    std::cout << "Hits en A1in   : " << queue_hits[RECENT] << "\n"
+              << "Hits en Am     : " << queue_hits[FREQUENT] << "\n"
+              << "Desde A1out    : " << ghost_hits[RECENT] << "\n";
+  } else if (replacement_policy == ARC) {
+    std::cout << "Hits en T1     : " << queue_hits[RECENT] << "\n"
+              << "Hits en T2     : " << queue_hits[FREQUENT] << "\n"
+              << "Fantasmas B1/B2: " << ghost_hits[RECENT] << " / "
+              << ghost_hits[FREQUENT] << "\n";
+  } else if (replacement_policy == LRU_2) {
+    std::cout << "Hits con 2+ ref: " << queue_hits[FREQUENT] << "\n"
+              << "Con historial  : " << ghost_hits[RECENT] << "\n";
+  }
+}
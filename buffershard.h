@@ -0,0 +1,321 @@
+#pragma once
+
+#include "bgwriter.h"
+#include "disk.h"
+#include "extents.h"
+#include "framearena.h"
+#include "prefetch.h"
+#include "scheduler.h"
+#include "wal.h"
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+struct Frame {
+  int block_id;
+  bool dirty;
+  int time;
+  int pin_count;
+  bool ref_bit;
+  uint64_t page_lsn;
+  char *data = nullptr; // dentro del FrameArena del shard
+  int prev_time = 0; // LRU-2: penultimo acceso (0 = solo uno)
+  // Listas intrusivas de frames ocupados y sin pin (-1 = sin vecino). queue es
+  // la lista que le toca segun la politica y se conserva mientras esta pineado
+  int lru_prev = -1;
+  int lru_next = -1;
+  int queue = -1;
+  bool linked = false;
+  bool in_ring = false; // reservado para el anillo de un recorrido
+  bool loading = false;     // lectura de un fallo en curso (pineado por ella)
+  bool prefetching = false; // lectura anticipada en curso (pineado por ella)
+  bool prefetched = false;  // cargado por adelantado y aun sin acceder
+  bool cleaning = false;    // copia en el escritor de fondo, sin confirmar
+  bool warmed = false;      // precargado del warm set y aun sin acceder
+  int uses = 0;             // accesos desde que se cargo el bloque
+  // Latch de lectura/escritura sobre data. Solo se toma con el frame pineado
+  // y sin el latch del shard, asi esperar a otro hilo no bloquea el shard.
+  std::shared_mutex latch;
+};
+
+struct FrameQueue {
+  int head = -1; // menos reciente
+  int tail = -1;
+  int count = 0; // frames asignados, incluidos los pineados
+};
+
+// Bloques ya desalojados que la politica recuerda, del mas antiguo al mas nuevo
+struct GhostList {
+  std::list<int> order;
+  std::unordered_map<int, std::list<int>::iterator> pos;
+
+  bool contains(int block_id) const;
+  void push(int block_id);
+  bool erase(int block_id);
+  int popFront();
+  int size() const;
+  void clear();
+};
+
+enum ReplacementPolicy { LRU, CLOCK, TWO_Q, LRU_2, ARC };
+
+// lru / clock / 2q / lru2 / arc; false si el nombre no es una politica
+bool parsePolicy(const std::string &name, ReplacementPolicy &policy);
+
+// Los bloques se reparten entre shards en franjas de SHARD_STRIPE bloques
+// consecutivos, asi un lote de un recorrido sigue siendo contiguo en disco
+constexpr int SHARD_STRIPE = 8;
+
+inline int shardOfBlock(int block_id, int shard_count) {
+  return (block_id / SHARD_STRIPE) % shard_count;
+}
+
+class BufferShard;
+
+// Frame pineado que sostiene un PageGuard. shard es nulo cuando data apunta
+// al mapeo del disco (backend=mmap) y no hay frame.
+struct FrameRef {
+  BufferShard *shard = nullptr;
+  int frame = -1;
+  char *data = nullptr;
+  int size = 0;
+  std::shared_mutex *latch = nullptr;
+};
+
+// Contadores de un shard; BufferManager los suma
+struct BufferCounters {
+  int accesses = 0;
+  int hits = 0;
+  int zero_copy_reads = 0;
+  int ring_reuses = 0;
+  int prefetch_issued = 0;
+  int prefetch_hits = 0;
+  int prefetch_wasted = 0;
+  int bg_rounds = 0;
+  int bg_writes = 0;
+  int eviction_writes = 0;
+  int warm_loaded = 0;
+  int warm_hits = 0;
+};
+
+// Una particion del buffer pool con sus frames, su politica de reemplazo,
+// los recorridos en curso y sus hilos de prefetch y escritura de fondo. Cada
+// operacion publica toma el latch del shard; es recursivo porque algunas se
+// llaman entre si (evictAll -> flushAll). Las lecturas de un fallo se hacen
+// sin el: el frame queda pineado y marcado loading, y otro hilo que pida el
+// mismo bloque espera a que termine sin bloquear al resto del shard.
+class BufferShard {
+public:
+  BufferShard(Disk &disk_, IOScheduler &scheduler_, WriteAheadLog &wal_,
+              int frame_count_, const std::string &policy, int shard_index_ = 0,
+              int shard_count_ = 1);
+
+  FrameRef fix(int block_id);
+  FrameRef fixView(int block_id);
+  void unfix(int frame_idx, bool dirty, uint64_t lsn);
+  void flushBlock(int block_id);
+  void discardBlock(int block_id);
+  void flushAll();
+  int dirtyCount() const;
+  int hitCount() const;
+  int accessCount() const;
+  void evictAll();
+
+  // Recorridos secuenciales: con la lista de bloques por delante, un fallo
+  // carga de una vez los siguientes bloques no residentes con Disk::readBlocks.
+  // Si la relacion ocupa mas de un cuarto del pool, sus fallos se cargan en un
+  // anillo privado de frames que se reutiliza en orden, asi el recorrido no
+  // desaloja al resto. Los bloques que ya estaban en el pool se usan ahi.
+  // Cada hilo tiene su propio recorrido, con su lista y su anillo, asi dos
+  // recorridos simultaneos sobre el mismo shard no se quitan frames ni lotes.
+  //
+  // Con prefetch_window > 0 (disk.cfg o el comando prefetch) cada acceso del
+  // recorrido encola en un hilo de E/S los proximos bloques no residentes de
+  // la ventana, para que la lectura se solape con el trabajo sobre los
+  // anteriores. Un acceso a un bloque en vuelo espera solo a ese bloque.
+  void beginScan(const ExtentList &block_ids);
+  void endScan();
+  void setPrefetchWindow(int window);
+  int prefetchWindow() const;
+  bool prefetchEnabled() const;
+
+  // Escritura de fondo: cada bgwriter_delay_ms, si hay menos de
+  // bgwriter_clean_pct % de frames limpios, hasta bgwriter_max_pages frames
+  // sucios, sin pin y de acceso mas antiguo se copian a un hilo que los
+  // escribe. Se llama en los fallos y entre comandos; asi la victima de un
+  // fallo casi nunca esta sucia.
+  void trickleDirty();
+
+  // Cambia en caliente el numero de frames y/o la politica. Los bloques de
+  // acceso mas reciente se copian a una arena nueva y los que no entran se
+  // escriben si estan sucios. Con la misma politica se conservan las listas y
+  // el historial (los que no entran pasan a el, recortado al tamaño nuevo);
+  // una politica nueva arranca sin historial y los que se quedan entran como
+  // recien cargados, del mas antiguo al mas nuevo. Devuelve false, sin tocar
+  // nada, si hay frames pineados.
+  bool reconfigure(int new_count, ReplacementPolicy policy);
+
+  // Para operaciones sobre todos los shards (BufferManager::reconfigure):
+  // con los latches tomados nadie pinea entre la comprobacion y el cambio
+  std::unique_lock<std::recursive_mutex> lockShard() const;
+  bool hasPinnedFrames();
+
+  // Warm set: bloques residentes fuera del anillo, del mas caliente al mas
+  // frio por ultimo acceso o por cantidad de accesos. preload los carga en
+  // frames vacios con un lote de E/S y sin desalojar a nadie; devuelve
+  // cuantos cargo. El primer acceso a cada uno cuenta como fallo evitado.
+  std::vector<int> warmSet(bool by_frequency) const;
+  int preload(const std::vector<int> &block_ids);
+
+  BufferCounters counters() const;
+  int frameCount() const;
+  std::string policyName() const;
+  ReplacementPolicy replacementPolicy() const;
+
+  void printStatus() const;
+  void printHitRate() const;
+
+private:
+  Disk &disk;
+  IOScheduler &scheduler;
+  WriteAheadLog &wal;
+  int frame_count;
+  int current_time;
+  int clock_hand;
+  ReplacementPolicy replacement_policy;
+  int shard_index;
+  int shard_count;
+  mutable std::recursive_mutex shard_latch;
+  using ShardLock = std::unique_lock<std::recursive_mutex>;
+  std::condition_variable_any load_cv; // se avisa al terminar cada lectura
+  std::atomic<int> total_accesses{0};
+  std::atomic<int> cache_hits{0};
+  std::atomic<int> zero_copy_reads{0};
+
+  std::unique_ptr<FrameArena> arena;
+  std::vector<Frame> frames;
+  std::unordered_map<int, int> block_to_frame;
+  // Frames con pin_count == 0; se actualiza en cada cambio de pin, asi los
+  // limites de lote y de prefetch no recorren todos los frames en cada fallo
+  int unpinned;
+
+  // LRU usa solo RECENT. 2Q: RECENT = A1in (FIFO), FREQUENT = Am (LRU).
+  // ARC: RECENT = T1, FREQUENT = T2. Los frames vacios van aparte, en una pila
+  // que entrega primero el de menor indice.
+  static constexpr int RECENT = 0;
+  static constexpr int FREQUENT = 1;
+  FrameQueue queues[2];
+  std::vector<int> free_frames;
+  int queue_hits[2] = {0, 0};
+  int ghost_hits[2] = {0, 0};
+
+  // 2Q: A1out guarda los desalojados de A1in
+  int kin;
+  int kout;
+  GhostList a1out;
+
+  // ARC: B1/B2 fantasmas de T1/T2; arc_p es el tamaño objetivo de T1
+  GhostList arc_b1;
+  GhostList arc_b2;
+  int arc_p = 0;
+
+  // LRU-2: frames sin pin ordenados por (penultimo, ultimo) acceso, y el
+  // ultimo acceso de bloques desalojados para no perder su historial
+  std::set<std::tuple<int, int, int>> lru2_order;
+  GhostList lru2_history;
+  std::unordered_map<int, int> lru2_history_time;
+
+  static constexpr int SCAN_BATCH = 8;
+  static constexpr int SCAN_RING = 32;
+  struct ScanState {
+    ExtentList blocks;
+    bool use_ring = false;
+    std::vector<int> ring;
+    size_t ring_pos = 0;
+  };
+  std::unordered_map<std::thread::id, ScanState> scans;
+  int ring_size;
+  std::atomic<int> ring_reuses{0};
+
+  int prefetch_window;
+  std::atomic<int> prefetch_issued{0};
+  std::atomic<int> prefetch_hits{0};
+  std::atomic<int> prefetch_wasted{0};
+  // Despues de frames: el hilo escribe en sus buffers y se detiene primero.
+  // Compartido con quien espera un bloque en vuelo sin el latch.
+  std::shared_ptr<Prefetcher> prefetcher;
+
+  int bgwriter_clean_pct;
+  int bgwriter_max_pages;
+  std::chrono::milliseconds bgwriter_delay;
+  std::chrono::steady_clock::time_point last_trickle;
+  std::atomic<int> bg_rounds{0};
+  std::atomic<int> bg_writes{0};
+  std::atomic<int> eviction_writes{0};
+  std::unique_ptr<BackgroundWriter> bgwriter;
+
+  std::atomic<int> warm_loaded{0};
+  std::atomic<int> warm_hits{0};
+
+  FrameRef fixLocked(ShardLock &lock, int block_id);
+  std::unordered_map<int, int>::iterator awaitBlock(ShardLock &lock, int block_id);
+  int fetchFrame(ShardLock &lock, int block_id);
+  void pinFrame(int frame_idx);
+  void unpinFrame(int frame_idx);
+  void loadBlocks(ShardLock &lock, const std::vector<int> &block_ids, ScanState *scan);
+  void writeVictim(int frame_idx);
+  void restoreVictim(int frame_idx);
+  void abandonLoad(int frame_idx);
+  ScanState *currentScan();
+  std::vector<int> scanBatchFor(const ScanState &scan, int block_id);
+  int evictFrame(int block_id);
+  int evictLRU();
+  int evictClock();
+  int evict2Q(int block_id);
+  int evictLRU2(int block_id);
+  int evictARC(int block_id);
+  int arcReplace(bool in_b2, bool from_t1);
+  int popFreeFrame();
+  int ringFrame(ScanState &scan, int block_id);
+  void leaveRing(int frame_idx);
+  void releaseRing(ScanState &scan);
+  void prefetchAhead(int block_id);
+  void finishPrefetch(int frame_idx, bool ok);
+  void reapPrefetches();
+  void drainPrefetches();
+  void forgetPrefetched(Frame &f);
+  void settleWrite(int frame_idx);
+  void reapWrites();
+  void takeVictim(int frame_idx);
+  void touchFrame(int frame_idx);
+
+  void queueUnlink(int frame_idx);
+  void queuePushBack(int frame_idx);
+  void queuePushFront(int frame_idx);
+  void assignQueue(int frame_idx, int queue);
+  void attachFrame(int frame_idx);
+  void detachFrame(int frame_idx);
+  void releaseFrame(int frame_idx);
+  void clearHistory();
+  void rememberEvicted(const Frame &f);
+  void trimHistory();
+  bool ownsBlock(int block_id) const;
+  std::unique_ptr<FrameArena> makeArena(int count) const;
+  void resetFrame(int frame_idx);
+  void sizePolicy();
+
+  void printStatusLRU() const;
+  void printStatusClock() const;
+  void printStatusQueues() const;
+  void printStatusLRU2() const;
+};
@@ -1,11 +1,14 @@
 #include "catalog.h"
+#include "allocator.h"
+#include <algorithm>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
-Catalog::Catalog(Disk &disk_) : disk(disk_) {}
+Catalog::Catalog(Disk &disk_, Allocator &allocator_)
+    : disk(disk_), allocator(allocator_) {}
 
 bool Catalog::hasRelation(const std::string &name) const {
   return relations.find(name) != relations.end();
@@ -52,10 +55,10 @@ void Catalog::addRelation(const Relation &relation) {
               << ")\n";
   }
   std::cout << "Bloques asignados: ";
-  for (size_t i = 0; i < relation.blocks.size(); ++i) {
-    std::cout << relation.blocks[i];
-    if (i + 1 < relation.blocks.size())
-      std::cout << ", ";
+  const char *sep = "";
+  for (int block : relation.blocks) {
+    std::cout << sep << block;
+    sep = ", ";
   }
   if (relation.blocks.empty())
     std::cout << "ninguno";
@@ -67,9 +70,201 @@ void Catalog::addRelation(const Relation &relation) {
   }
 }
 
+namespace {
+
+void putInt(std::vector<char> &out, int32_t v) {
+  const char *p = reinterpret_cast<const char *>(&v);
+  out.insert(out.end(), p, p + 4);
+}
+
+void putString(std::vector<char> &out, const std::string &str) {
+  putInt(out, str.size());
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+// Lector secuencial que marca error en vez de leer fuera del buffer
+struct Reader {
+  const std::vector<char> &data;
+  size_t pos = 0;
+  bool ok = true;
+
+  int32_t getInt() {
+    int32_t v = 0;
+    if (pos + 4 > data.size()) {
+      ok = false;
+      return 0;
+    }
+    std::memcpy(&v, &data[pos], 4);
+    pos += 4;
+    return v;
+  }
+
+  std::string getString() {
+    int32_t len = getInt();
+    if (!ok || len < 0 || pos + len > data.size()) {
+      ok = false;
+      return "";
+    }
+    std::string str(&data[pos], len);
+    pos += len;
+    return str;
+  }
+};
+
+} // namespace
+
+std::vector<char> Catalog::serialize(const Relation &rel) {
+  std::vector<char> out;
+  putString(out, rel.name);
+  putInt(out, rel.is_fixed);
+  putInt(out, rel.hash_index_block);
+  putInt(out, rel.btree_index_block);
+  putInt(out, rel.fsm_block);
+  putInt(out, rel.fields.size());
+  for (const Field &f : rel.fields) {
+    putString(out, f.name);
+    putString(out, f.type);
+    putInt(out, f.size);
+  }
+
+  putInt(out, rel.blocks.extents().size());
+  for (const Extent &e : rel.blocks.extents()) {
+    putInt(out, e.start);
+    putInt(out, e.length);
+  }
+  return out;
+}
+
+bool Catalog::deserialize(const std::vector<char> &data, Relation &rel) {
+  Reader in{data};
+  rel.name = in.getString();
+  rel.is_fixed = in.getInt() != 0;
+  rel.hash_index_block = in.getInt();
+  rel.btree_index_block = in.getInt();
+  rel.fsm_block = in.getInt();
+  int num_fields = in.getInt();
+  for (int i = 0; in.ok && i < num_fields; ++i) {
+    Field f;
+    f.name = in.getString();
+    f.type = in.getString();
+    f.size = in.getInt();
+    // Como en el formato de texto, los campos variables no tienen tamaño
+    if (!rel.is_fixed)
+      f.size = 0;
+    rel.fields.push_back(f);
+  }
+  int num_extents = in.getInt();
+  for (int i = 0; in.ok && i < num_extents; ++i) {
+    int start = in.getInt();
+    int length = in.getInt();
+    if (in.ok)
+      rel.blocks.addExtent(start, length);
+  }
+  return in.ok && !rel.name.empty();
+}
+
+bool Catalog::readChain(int head, Chain &chain, std::vector<char> &payload) const {
+  int page = head;
+  while (page != -1) {
+    if (page < 0 || page >= disk.totalBlocks() ||
+        (int)chain.pages.size() >= disk.totalBlocks())
+      return false;
+    std::vector<char> image = disk.readBlock(page);
+    if ((int)image.size() < PAGE_HEADER)
+      return false;
+    uint32_t magic;
+    int32_t next, used;
+    std::memcpy(&magic, &image[0], 4);
+    std::memcpy(&next, &image[4], 4);
+    std::memcpy(&used, &image[8], 4);
+    if (magic != PAGE_MAGIC || used < 0 || used > disk.block_size - PAGE_HEADER)
+      return false;
+    payload.insert(payload.end(), image.begin() + PAGE_HEADER,
+                   image.begin() + PAGE_HEADER + used);
+    chain.pages.push_back(page);
+    chain.images.push_back(std::move(image));
+    page = next;
+  }
+  return true;
+}
+
+// Reparte payload en las paginas de la cadena, pidiendo o liberando paginas
+// segun haga falta, y deja en pages solo las que cambiaron
+void Catalog::writeChain(Chain &chain, const std::vector<char> &payload,
+                         BlockImages &pages) {
+  int capacity = disk.block_size - PAGE_HEADER;
+  size_t needed = std::max<size_t>(1, (payload.size() + capacity - 1) / capacity);
+
+  while (chain.pages.size() < needed) {
+    int page = allocator.allocateIndex();
+    if (page == -1)
+      throw std::runtime_error("No hay bloques libres para el catálogo");
+    chain.pages.push_back(page);
+  }
+  while (chain.pages.size() > needed) {
+    allocator.freeBlock(chain.pages.back());
+    chain.pages.pop_back();
+  }
+  chain.images.resize(needed);
+
+  for (size_t i = 0; i < needed; ++i) {
+    size_t first = i * capacity;
+    int32_t used = std::min<size_t>(capacity, payload.size() - std::min(first, payload.size()));
+    int32_t next = i + 1 < needed ? chain.pages[i + 1] : -1;
+
+    std::vector<char> image(disk.block_size, 0);
+    std::memcpy(&image[0], &PAGE_MAGIC, 4);
+    std::memcpy(&image[4], &next, 4);
+    std::memcpy(&image[8], &used, 4);
+    std::copy(payload.begin() + first, payload.begin() + first + used,
+              image.begin() + PAGE_HEADER);
+
+    if (image != chain.images[i]) {
+      pages[chain.pages[i]] = image;
+      chain.images[i] = std::move(image);
+    }
+  }
+}
+
+void Catalog::freeChain(Chain &chain) {
+  for (int page : chain.pages)
+    allocator.freeBlock(page);
+  chain.pages.clear();
+  chain.images.clear();
+}
+
 void Catalog::load() {
-  std::vector<char> raw = disk.readBlock(1);
-  std::istringstream iss(std::string(raw.data(), raw.size()));
+  relations.clear();
+  chains.clear();
+  directory = Chain{};
+
+  std::vector<char> payload;
+  if (!readChain(DIRECTORY_BLOCK, directory, payload)) {
+    // Catalogo de texto de versiones anteriores: se migra en el proximo save
+    directory = Chain{};
+    loadLegacy(disk.readBlock(DIRECTORY_BLOCK));
+    return;
+  }
+
+  Reader in{payload};
+  int count = in.getInt();
+  for (int i = 0; in.ok && i < count; ++i) {
+    int head = in.getInt();
+    Chain chain;
+    std::vector<char> record;
+    Relation rel;
+    if (!readChain(head, chain, record) || !deserialize(record, rel)) {
+      std::cerr << "Advertencia: entrada de catálogo ilegible en el bloque "
+                << head << std::endl;
+      continue;
+    }
+    chains[rel.name] = std::move(chain);
+    relations[rel.name] = std::move(rel);
+  }
+}
+
+void Catalog::loadLegacy(const std::vector<char> &raw) {
+  std::istringstream iss(std::string(raw.data(), strnlen(raw.data(), raw.size())));
 
   std::string line;
   while (std::getline(iss, line)) {
@@ -82,6 +277,9 @@ void Catalog::load() {
     int num_fields;
 
     header >> rel.name >> mode >> num_fields;
+    // Opcional: catalogos anteriores al mapa de espacio libre no lo tienen
+    if (!(header >> rel.fsm_block))
+      rel.fsm_block = -1;
 
     if (rel.name.empty() || (mode != "fix" && mode != "var") ||
         num_fields <= 0) {
@@ -103,12 +301,15 @@ void Catalog::load() {
       rel.fields.push_back(f);
     }
 
-    // Leer bloques de datos
+    // Leer bloques de datos: numeros sueltos o corridas "inicio-fin"
     if (std::getline(iss, line)) {
       std::istringstream block_line(line);
-      int block;
-      while (block_line >> block) {
-        rel.blocks.push_back(block);
+      std::string token;
+      while (block_line >> token) {
+        size_t dash = token.find('-', 1);
+        int first = std::stoi(token.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(token.substr(dash + 1));
+        rel.blocks.addExtent(first, last - first + 1);
       }
     }
 
@@ -131,37 +332,26 @@ void Catalog::load() {
   }
 }
 
-void Catalog::save() const {
-  std::ostringstream oss;
+void Catalog::save(BlockImages &pages) {
+  for (auto &[name, rel] : relations)
+    writeChain(chains[name], serialize(rel), pages);
 
-  for (const auto &pair : relations) {
-    const Relation &rel = pair.second;
-    oss << rel.name << " " << (rel.is_fixed ? "fix" : "var") << " "
-        << rel.fields.size() << "\n";
-    for (const Field &f : rel.fields) {
-      oss << f.name << " " << f.type;
-      if (rel.is_fixed)
-        oss << " " << f.size;
-      oss << "\n";
-    }
-    for (size_t i = 0; i < rel.blocks.size(); ++i) {
-      oss << rel.blocks[i];
-      if (i + 1 < rel.blocks.size())
-        oss << " ";
-    }
-    oss << "\n";
-    // Siempre escribe ambos campos, aunque sean -1
-    if (rel.is_fixed) {
-      oss << rel.hash_index_block << "\n";
-      oss << rel.btree_index_block << "\n";
-    }
-  }
+  // El directorio se ordena por pagina para que no cambie entre llamadas
+  std::vector<int> heads;
+  for (const auto &[name, chain] : chains)
+    heads.push_back(chain.pages[0]);
+  std::sort(heads.begin(), heads.end());
+
+  std::vector<char> payload;
+  putInt(payload, heads.size());
+  for (int head : heads)
+    putInt(payload, head);
 
-  std::string content = oss.str();
-  std::vector<char> block(disk.block_size, 0);
-  std::memcpy(block.data(), content.data(),
-              std::min(content.size(), block.size()));
-  disk.writeBlock(1, block);
+  if (directory.pages.empty()) {
+    directory.pages.push_back(DIRECTORY_BLOCK);
+    directory.images.emplace_back();
+  }
+  writeChain(directory, payload, pages);
 }
 
 void Catalog::print() const {
@@ -180,10 +370,10 @@ void Catalog::print() const {
                 << ")\n";
     }
     std::cout << "Bloques asignados: ";
-    for (size_t i = 0; i < rel.blocks.size(); ++i) {
-      std::cout << rel.blocks[i];
-      if (i + 1 < rel.blocks.size())
-        std::cout << ", ";
+    const char *sep = "";
+    for (int block : rel.blocks) {
+      std::cout << sep << block;
+      sep = ", ";
     }
     if (rel.blocks.empty())
       std::cout << "ninguno";
@@ -202,6 +392,12 @@ void Catalog::removeRelation(const std::string &name) {
   if (it == relations.end())
     throw std::runtime_error("No se encontró la relación: " + name);
   relations.erase(it);
+
+  auto chain = chains.find(name);
+  if (chain != chains.end()) {
+    freeChain(chain->second);
+    chains.erase(chain);
+  }
 }
 
 const std::unordered_map<std::string, Relation> &
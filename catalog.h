@@ -1,6 +1,8 @@
 #pragma once
 
 #include "disk.h"
+#include "extents.h"
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -15,17 +17,26 @@ struct Relation {
   std::string name;
   bool is_fixed;
   std::vector<Field> fields;
-  std::vector<int> blocks;
+  ExtentList blocks;
   int hash_index_block = -1;
   int btree_index_block = -1;
+  int fsm_block = -1;
 };
 
+class Allocator;
+
+// Catalogo binario en cadenas de paginas. El directorio empieza en el bloque 1
+// y lista la pagina inicial de cada relacion; cada relacion tiene su propia
+// cadena con nombre, campos, bloques de indices y sus bloques como extents
+// (inicio, largo). save() serializa todo pero solo entrega las paginas cuyo
+// contenido cambio respecto de lo ultimo leido o entregado; quien llama las
+// registra en el WAL y las escribe.
 class Catalog {
 public:
-  Catalog(Disk &disk);
+  Catalog(Disk &disk, Allocator &allocator);
 
   void load();
-  void save() const;
+  void save(BlockImages &pages);
   void addRelation(const Relation &relation);
   bool hasRelation(const std::string &name) const;
   const Relation &getRelation(const std::string &name) const;
@@ -35,6 +46,26 @@ public:
   const std::unordered_map<std::string, Relation> &getAllRelations() const;
 
 private:
+  // Paginas de una cadena y su ultimo contenido en disco
+  struct Chain {
+    std::vector<int> pages;
+    std::vector<std::vector<char>> images;
+  };
+
+  static constexpr uint32_t PAGE_MAGIC = 0xCA7A1060;
+  static constexpr int PAGE_HEADER = 12; // magic, siguiente, bytes usados
+  static constexpr int DIRECTORY_BLOCK = 1;
+
   Disk &disk;
+  Allocator &allocator;
   std::unordered_map<std::string, Relation> relations;
+  std::unordered_map<std::string, Chain> chains;
+  Chain directory;
+
+  bool readChain(int head, Chain &chain, std::vector<char> &payload) const;
+  void writeChain(Chain &chain, const std::vector<char> &payload, BlockImages &pages);
+  void freeChain(Chain &chain);
+  static std::vector<char> serialize(const Relation &rel);
+  static bool deserialize(const std::vector<char> &data, Relation &rel);
+  void loadLegacy(const std::vector<char> &raw);
 };
@@ -0,0 +1,84 @@
+#include "checkpoint.h"
+#include "hash_index.h"
+#include "sgbd.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+CheckpointManager::CheckpointManager(SGBD &sgbd_)
+    : sgbd(sgbd_),
+      interval_s(std::max(0, sgbd_.disk.intOption("checkpoint_interval_s", 30))),
+      dirty_threshold(std::max(1, sgbd_.disk.intOption("checkpoint_dirty_pages", 64))),
+      last(std::chrono::steady_clock::now()) {}
+
+void CheckpointManager::markDirty() {
+  ++pending;
+  catalog_changed = true;
+}
+
+// El catalogo puede pedir paginas nuevas, por eso el bitmap se serializa
+// despues. Sin cambios de metadatos es un COMMIT comun del group commit.
+void CheckpointManager::commit() {
+  BlockImages pages;
+  if (catalog_changed) {
+    sgbd.catalog.save(pages);
+    catalog_changed = false;
+  }
+  HashIndex::saveAll(sgbd.disk, pages);
+  sgbd.bitmap.save(pages);
+
+  for (const auto &[block, data] : pages)
+    sgbd.wal.logUpdate(block, 0, data.data(), static_cast<int>(data.size()));
+  sgbd.wal.commit();
+  if (pages.empty())
+    return;
+
+  sgbd.wal.flush();
+  std::vector<int> ids;
+  std::vector<const char *> buffers;
+  for (const auto &[block, data] : pages) {
+    ids.push_back(block);
+    buffers.push_back(data.data());
+  }
+  for (bool ok : sgbd.disk.writeBlocks(ids, buffers))
+    if (!ok)
+      throw std::runtime_error("No se pudieron escribir los metadatos");
+}
+
+void CheckpointManager::maybeCheckpoint() {
+  int dirty = pending + sgbd.bufferManager->dirtyCount();
+  if (dirty == 0)
+    return;
+  auto elapsed = std::chrono::steady_clock::now() - last;
+  if (dirty >= dirty_threshold || elapsed >= std::chrono::seconds(interval_s))
+    checkpoint();
+}
+
+// Los mapas de espacio libre pueden pedir bloques nuevos y cambiar su primer
+// bloque en el catalogo; esos cambios van en un commit propio antes de volcar
+// el pool, asi una caida a mitad del checkpoint se rehace desde el WAL
+void CheckpointManager::checkpoint() {
+  auto start = std::chrono::steady_clock::now();
+
+  for (const auto &[name, rel] : sgbd.catalog.getAllRelations())
+    sgbd.fsm.save(sgbd.catalog.getRelation(name), sgbd.allocator);
+  catalog_changed = true;
+  commit();
+  sgbd.bufferManager->flushAll();
+  sgbd.disk.sync();
+  sgbd.wal.truncate();
+
+  pending = 0;
+  last = std::chrono::steady_clock::now();
+  ++checkpoints;
+  total_ms += std::chrono::duration<double, std::milli>(last - start).count();
+}
+
+void CheckpointManager::printStats() const {
+  std::cout << "Checkpoints: " << checkpoints;
+  if (checkpoints > 0)
+    std::cout << " (" << total_ms / checkpoints << " ms en promedio)";
+  std::cout << ", cambios pendientes: " << pending
+            << ", cada " << interval_s << " s o " << dirty_threshold
+            << " paginas sucias" << std::endl;
+}
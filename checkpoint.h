@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+
+class SGBD;
+
+// Persistencia de metadatos. commit() cierra la transaccion de cada comando:
+// las paginas de bitmap, catalogo e indices hash que cambiaron se registran
+// enteras en el WAL dentro de la misma transaccion que los datos y se
+// escriben recien cuando ese COMMIT es durable. Tras una caida el WAL rehace
+// juntos los bloques asignados y los metadatos que los describen. Los mapas
+// de espacio libre son solo una pista y se escriben en el checkpoint.
+//
+// Un checkpoint guarda los mapas de espacio libre, hace commit de los
+// metadatos que eso cambie, vuelca las paginas sucias del buffer pool,
+// sincroniza el disco y trunca el WAL. Entre comandos de la shell se hace
+// cuando pasaron checkpoint_interval_s segundos o cuando los cambios
+// pendientes (metadatos marcados mas frames sucios) llegan a
+// checkpoint_dirty_pages.
+class CheckpointManager {
+public:
+  CheckpointManager(SGBD &sgbd);
+
+  void markDirty();
+  void commit();
+  void maybeCheckpoint();
+  void checkpoint();
+  void printStats() const;
+
+private:
+  SGBD &sgbd;
+  int interval_s;
+  int dirty_threshold;
+  int pending = 0;
+  bool catalog_changed = false;
+  std::chrono::steady_clock::time_point last;
+
+  int checkpoints = 0;
+  double total_ms = 0;
+};
@@ -0,0 +1,100 @@
+#include "codec.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static constexpr int HASH_BITS = 12;
+
+static uint32_t read32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static void writeLength(std::vector<char> &out, size_t len) {
+  while (len >= 255) {
+    out.push_back(static_cast<char>(255));
+    len -= 255;
+  }
+  out.push_back(static_cast<char>(len));
+}
+
+static bool readLength(const char *src, size_t len, size_t &in, size_t &value) {
+  unsigned char b;
+  do {
+    if (in >= len) return false;
+    b = static_cast<unsigned char>(src[in++]);
+    value += b;
+  } while (b == 255);
+  return true;
+}
+
+static void emitSequence(std::vector<char> &out, const char *literals, size_t lit_len,
+                         size_t offset, size_t match_len) {
+  size_t code = match_len >= BlockCodec::MIN_MATCH ? match_len - BlockCodec::MIN_MATCH : 0;
+  out.push_back(static_cast<char>((std::min<size_t>(lit_len, 15) << 4) |
+                                  std::min<size_t>(code, 15)));
+  if (lit_len >= 15) writeLength(out, lit_len - 15);
+  out.insert(out.end(), literals, literals + lit_len);
+  if (match_len == 0) return;
+
+  out.push_back(static_cast<char>(offset & 0xff));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (code >= 15) writeLength(out, code - 15);
+}
+
+void BlockCodec::compress(const char *src, size_t len, std::vector<char> &out) {
+  out.clear();
+  int table[1 << HASH_BITS];
+  std::fill(table, table + (1 << HASH_BITS), -1);
+
+  size_t anchor = 0, i = 0;
+  while (i + MIN_MATCH <= len) {
+    uint32_t seq = read32(src + i);
+    uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+    int candidate = table[h];
+    table[h] = static_cast<int>(i);
+
+    if (candidate < 0 || i - candidate > MAX_OFFSET || read32(src + candidate) != seq) {
+      ++i;
+      continue;
+    }
+
+    size_t match_len = MIN_MATCH;
+    while (i + match_len < len && src[candidate + match_len] == src[i + match_len])
+      ++match_len;
+    emitSequence(out, src + anchor, i - anchor, i - candidate, match_len);
+    i += match_len;
+    anchor = i;
+  }
+  emitSequence(out, src + anchor, len - anchor, 0, 0);
+}
+
+bool BlockCodec::decompress(const char *src, size_t len, char *dst, size_t dst_len) {
+  size_t in = 0, written = 0;
+  while (in < len) {
+    unsigned char token = static_cast<unsigned char>(src[in++]);
+
+    size_t lit_len = token >> 4;
+    if (lit_len == 15 && !readLength(src, len, in, lit_len)) return false;
+    if (in + lit_len > len || written + lit_len > dst_len) return false;
+    std::memcpy(dst + written, src + in, lit_len);
+    in += lit_len;
+    written += lit_len;
+    if (in == len) break;
+
+    if (in + 2 > len) return false;
+    size_t offset = static_cast<unsigned char>(src[in]) |
+                    (static_cast<size_t>(static_cast<unsigned char>(src[in + 1])) << 8);
+    in += 2;
+    size_t match_len = token & 15;
+    if (match_len == 15 && !readLength(src, len, in, match_len)) return false;
+    match_len += MIN_MATCH;
+    if (offset == 0 || offset > written || written + match_len > dst_len) return false;
+
+    // Byte a byte: la copia puede solaparse con lo que va escribiendo
+    for (size_t k = 0; k < match_len; ++k, ++written)
+      dst[written] = dst[written - offset];
+  }
+  return written == dst_len;
+}
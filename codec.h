@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Compresion LZ77 por bloque con el formato de secuencias de LZ4. Los campos
+// fijos se rellenan con espacios y los registros repiten estructura, asi que
+// casi todo el bloque se codifica como copias de lo ya visto.
+//   token (literales << 4 | largo de copia - MIN_MATCH), extension de
+//   literales, literales, desplazamiento (2 bytes), extension de copia
+// La ultima secuencia lleva solo literales.
+class BlockCodec {
+public:
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t MAX_OFFSET = 65535;
+
+  static void compress(const char *src, size_t len, std::vector<char> &out);
+  static bool decompress(const char *src, size_t len, char *dst, size_t dst_len);
+};
@@ -1,13 +1,119 @@
 #include "disk.h"
+#include "codec.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include <vector>
 
 namespace fs = std::filesystem;
 
+static DiskBackend parseBackend(const std::string &name) {
+  if (name == "dirs") return BACKEND_DIRS;
+  if (name == "image") return BACKEND_IMAGE;
+  if (name == "mmap") return BACKEND_MMAP;
+  if (name == "compressed") return BACKEND_COMPRESSED;
+  throw std::runtime_error("Backend de disco no reconocido: " + name);
+}
+
+static const char *backendLabel(DiskBackend backend) {
+  switch (backend) {
+  case BACKEND_DIRS: return "directorios";
+  case BACKEND_COMPRESSED: return "imagen comprimida";
+  default: return "imagen";
+  }
+}
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static void preadAll(int fd, char *dst, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = ::pread(fd, dst, len, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("Error leyendo la imagen: ") + std::strerror(errno));
+    }
+    if (n == 0) throw std::runtime_error("Lectura fuera de la imagen de disco");
+    dst += n;
+    len -= n;
+    offset += n;
+  }
+}
+
+// preadv/pwritev pueden transferir menos de lo pedido; avanza los iovec y
+// reintenta hasta completar
+static void advanceIov(std::vector<iovec> &iov, size_t &first, size_t done) {
+  while (done > 0 && first < iov.size()) {
+    if (done >= iov[first].iov_len) {
+      done -= iov[first].iov_len;
+      ++first;
+    } else {
+      iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + done;
+      iov[first].iov_len -= done;
+      done = 0;
+    }
+  }
+}
+
+static void preadvAll(int fd, std::vector<iovec> iov, off_t offset) {
+  size_t first = 0;
+  while (first < iov.size()) {
+    int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+    ssize_t n = ::preadv(fd, &iov[first], count, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("Error leyendo la imagen: ") + std::strerror(errno));
+    }
+    if (n == 0) throw std::runtime_error("Lectura fuera de la imagen de disco");
+    offset += n;
+    advanceIov(iov, first, n);
+  }
+}
+
+static void pwritevAll(int fd, std::vector<iovec> iov, off_t offset) {
+  size_t first = 0;
+  while (first < iov.size()) {
+    int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+    ssize_t n = ::pwritev(fd, &iov[first], count, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("Error escribiendo la imagen: ") + std::strerror(errno));
+    }
+    offset += n;
+    advanceIov(iov, first, n);
+  }
+}
+
+static void pwriteAll(int fd, const char *src, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = ::pwrite(fd, src, len, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("Error escribiendo la imagen: ") + std::strerror(errno));
+    }
+    src += n;
+    len -= n;
+    offset += n;
+  }
+}
+
 bool Disk::loadConfig(const std::string &filename, Disk::DiskConfig &cfg) {
   std::ifstream ifs(filename);
   if (!ifs) return false;
@@ -19,6 +125,15 @@ bool Disk::loadConfig(const std::string &filename, Disk::DiskConfig &cfg) {
     if (std::getline(iss, key, '=')) {
       std::string value_str;
       if (std::getline(iss, value_str)) {
+        if (key == "backend") {
+          std::istringstream(value_str) >> cfg.backend;
+          continue;
+        }
+        if (key != "platos" && key != "pistas" && key != "sectores" &&
+            key != "sector_size" && key != "sectors_per_block") {
+          std::istringstream(value_str) >> cfg.options[key];
+          continue;
+        }
         int value = std::stoi(value_str);
         if (key == "platos") cfg.platos = value;
         else if (key == "pistas") cfg.pistas = value;
@@ -31,62 +146,143 @@ bool Disk::loadConfig(const std::string &filename, Disk::DiskConfig &cfg) {
   return true;
 }
 
+// Se escribe a un temporal que se baja a disco y se renombra encima: quien
+// lea disk.cfg ve la version vieja o la nueva, nunca una a medias
 void Disk::saveConfig(const std::string &path, const DiskConfig &cfg) {
-  std::ofstream ofs(path, std::ios::trunc);
-  ofs << "platos=" << cfg.platos << "\n";
-  ofs << "pistas=" << cfg.pistas << "\n";
-  ofs << "sectores=" << cfg.sectores << "\n";
-  ofs << "sector_size=" << cfg.sector_size << "\n";
-  ofs << "sectors_per_block=" << cfg.sectors_per_block << "\n";
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    ofs << "platos=" << cfg.platos << "\n";
+    ofs << "pistas=" << cfg.pistas << "\n";
+    ofs << "sectores=" << cfg.sectores << "\n";
+    ofs << "sector_size=" << cfg.sector_size << "\n";
+    ofs << "sectors_per_block=" << cfg.sectors_per_block << "\n";
+    ofs << "backend=" << cfg.backend << "\n";
+    if (!ofs.flush())
+      throw std::runtime_error("No se pudo escribir la configuracion: " + tmp_path);
+  }
+  int fd = ::open(tmp_path.c_str(), O_RDONLY);
+  bool synced = fd >= 0 && ::fsync(fd) == 0;
+  if (fd >= 0) ::close(fd);
+  if (!synced || ::rename(tmp_path.c_str(), path.c_str()) != 0)
+    throw std::runtime_error("No se pudo guardar la configuracion: " + path);
 }
 
 bool Disk::configChanged(const DiskConfig &a, const DiskConfig &b) {
   return a != b;
 }
 
+// Con creacion perezosa cualquier subconjunto de sectores es valido
 bool Disk::directoryIsComplete() {
-  auto sample_sector = fs::path(root_path) / "plato0" / "superficie0" / "pista0" / "sector0";
-  return fs::exists(sample_sector);
+  return fs::is_directory(root_path);
+}
+
+bool Disk::imageIsComplete() {
+  std::error_code ec;
+  auto size = fs::file_size(image_path, ec);
+  return !ec && size == static_cast<std::uintmax_t>(totalBlocks()) * block_size;
+}
+
+bool Disk::compressedIsComplete() {
+  std::error_code ec;
+  auto size = fs::file_size(lz_map_path, ec);
+  return !ec && fs::exists(lz_path) &&
+         size == static_cast<std::uintmax_t>(totalBlocks()) * sizeof(BlockExtent);
 }
 
-Disk::Disk(const std::string &root, const std::string &config)
+Disk::Disk(const std::string &root, const std::string &config,
+           const std::map<std::string, std::string> &overrides)
     : root_path(root), config_file(config) {
+  image_path = (fs::path(root_path) / "disk.img").string();
+  lz_path = (fs::path(root_path) / "disk.lz").string();
+  lz_map_path = (fs::path(root_path) / "disk.map").string();
+
   DiskConfig user_cfg{};
   if (!loadConfig(config_file, user_cfg)) {
     throw std::runtime_error("No se pudo cargar la configuracion externa.");
   }
+  for (const auto &[key, value] : overrides)
+    user_cfg.options[key] = value;
+  DiskBackend wanted = parseBackend(user_cfg.backend);
 
   DiskConfig internal_cfg{};
   std::string internal_config_path = (fs::path(root_path) / "disk.cfg").string();
   bool internal_exists = loadConfig(internal_config_path, internal_cfg);
 
-  bool need_recreate = !internal_exists || configChanged(user_cfg, internal_cfg) || !directoryIsComplete();
+  bool need_recreate = !internal_exists || configChanged(user_cfg, internal_cfg);
+  if (!need_recreate) {
+    applyConfig(internal_cfg);
+    backend = parseBackend(internal_cfg.backend);
+    if (backend == BACKEND_DIRS)
+      need_recreate = !directoryIsComplete();
+    else if (backend == BACKEND_COMPRESSED)
+      need_recreate = !compressedIsComplete();
+    else
+      need_recreate = !imageIsComplete();
+  }
 
   if (need_recreate) {
     if (fs::exists(root_path)) fs::remove_all(root_path);
-    disk_config = user_cfg;
-
-    num_platos = disk_config.platos;
-    num_pistas = disk_config.pistas;
-    num_sectores = disk_config.sectores;
-    sector_size = disk_config.sector_size;
-    sectors_per_block = disk_config.sectors_per_block;
-    block_size = sector_size * sectors_per_block;
+    applyConfig(user_cfg);
+    backend = wanted;
 
-    createStructure();
+    if (backend == BACKEND_DIRS)
+      createStructure();
+    else if (backend == BACKEND_COMPRESSED)
+      createCompressed();
+    else
+      createImage();
     saveConfig(internal_config_path, disk_config);
-  } else {
-    disk_config = internal_cfg;
+  } else if (backend != wanted) {
+    disk_config.backend = user_cfg.backend;
+    convertBackend(backend, wanted, internal_config_path);
+  }
+
+  disk_config.options = user_cfg.options;
+
+  if (backend == BACKEND_IMAGE || backend == BACKEND_MMAP) openImage();
+  if (backend == BACKEND_MMAP) mapImage();
+  if (backend == BACKEND_COMPRESSED) openCompressed();
+  if (intOption("direct_io", 0) != 0) setDirectIO(true);
+
+  track_stats.resize(num_platos * num_superficies * num_pistas);
+}
 
-    num_platos = disk_config.platos;
-    num_pistas = disk_config.pistas;
-    num_sectores = disk_config.sectores;
-    sector_size = disk_config.sector_size;
-    sectors_per_block = disk_config.sectors_per_block;
-    block_size = sector_size * sectors_per_block;
+int Disk::intOption(const std::string &key, int default_value) const {
+  auto it = disk_config.options.find(key);
+  if (it == disk_config.options.end()) return default_value;
+  try {
+    return std::stoi(it->second);
+  } catch (const std::exception &) {
+    std::cerr << "Valor invalido para " << key << ": " << it->second << std::endl;
+    return default_value;
   }
 }
 
+std::string Disk::stringOption(const std::string &key, const std::string &default_value) const {
+  auto it = disk_config.options.find(key);
+  return it == disk_config.options.end() ? default_value : it->second;
+}
+
+Disk::~Disk() {
+  unmapImage();
+  closeImage();
+  closeCompressed();
+}
+
+void Disk::applyConfig(const DiskConfig &cfg) {
+  disk_config = cfg;
+
+  num_platos = disk_config.platos;
+  num_pistas = disk_config.pistas;
+  num_sectores = disk_config.sectores;
+  sector_size = disk_config.sector_size;
+  sectors_per_block = disk_config.sectors_per_block;
+  block_size = sector_size * sectors_per_block;
+}
+
+// Solo crea la raiz: los directorios de plato/superficie/pista y los archivos
+// de sector se materializan en la primera escritura (ver writeToDirs)
 void Disk::createStructure() {
   std::cout << "Creando estructura en " << root_path << std::endl;
 
@@ -95,33 +291,357 @@ void Disk::createStructure() {
       throw std::runtime_error("No se pudo crear el directorio raiz: " + root_path);
     }
   }
+}
 
-  for (int plato = 0; plato < num_platos; ++plato) {
-    std::string plato_dir = root_path + "/plato" + std::to_string(plato);
-    if (!fs::exists(plato_dir)) fs::create_directory(plato_dir);
-
-    for (int superficie = 0; superficie < num_superficies; ++superficie) {
-      std::string superficie_dir = plato_dir + "/superficie" + std::to_string(superficie);
-      if (!fs::exists(superficie_dir)) fs::create_directory(superficie_dir);
-
-      for (int pista = 0; pista < num_pistas; ++pista) {
-        std::string pista_dir = superficie_dir + "/pista" + std::to_string(pista);
-        if (!fs::exists(pista_dir)) fs::create_directory(pista_dir);
-
-        for (int sector = 0; sector < num_sectores; ++sector) {
-          std::string sector_file = pista_dir + "/sector" + std::to_string(sector);
-          if (!fs::exists(sector_file)) {
-            std::ofstream ofs(sector_file, std::ios::binary);
-            std::vector<char> empty(sector_size, 0);
-            ofs.write(empty.data(), sector_size);
-          }
-        }
+void Disk::createImage() {
+  std::cout << "Creando imagen de disco en " << image_path << std::endl;
+  fs::create_directories(root_path);
+
+  int fd = ::open(image_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::runtime_error("No se pudo crear la imagen de disco: " + image_path);
+
+  // Por defecto la imagen es dispersa: los huecos se leen como ceros y solo
+  // ocupan espacio al escribirse. prealloc=1 reserva todo de una vez para
+  // que la imagen no se fragmente.
+  off_t total_bytes = static_cast<off_t>(totalBlocks()) * block_size;
+  bool preallocated = intOption("prealloc", 0) != 0 &&
+                      ::posix_fallocate(fd, 0, total_bytes) == 0;
+  if (!preallocated && ::ftruncate(fd, total_bytes) != 0) {
+    ::close(fd);
+    throw std::runtime_error("No se pudo dimensionar la imagen de disco: " + image_path);
+  }
+  ::close(fd);
+}
+
+void Disk::createCompressed() {
+  std::cout << "Creando imagen comprimida en " << lz_path << std::endl;
+  fs::create_directories(root_path);
+
+  std::ofstream data(lz_path, std::ios::binary | std::ios::trunc);
+  if (!data)
+    throw std::runtime_error("No se pudo crear la imagen comprimida: " + lz_path);
+
+  // Un mapa en ceros: ningun bloque escrito todavia
+  int fd = ::open(lz_map_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  off_t map_bytes = static_cast<off_t>(totalBlocks()) * sizeof(BlockExtent);
+  if (fd < 0 || ::ftruncate(fd, map_bytes) != 0) {
+    if (fd >= 0) ::close(fd);
+    throw std::runtime_error("No se pudo crear el mapa de bloques: " + lz_map_path);
+  }
+  ::close(fd);
+}
+
+void Disk::openCompressed() {
+  if (lz_fd != -1) return;
+  lz_fd = ::open(lz_path.c_str(), O_RDWR);
+  lz_map_fd = ::open(lz_map_path.c_str(), O_RDWR);
+  if (lz_fd < 0 || lz_map_fd < 0) {
+    closeCompressed();
+    throw std::runtime_error("No se pudo abrir la imagen comprimida: " + lz_path);
+  }
+
+  extents.assign(totalBlocks(), BlockExtent{0, 0, 0});
+  preadAll(lz_map_fd, reinterpret_cast<char *>(extents.data()),
+           extents.size() * sizeof(BlockExtent), 0);
+
+  // El espacio libre no se guarda: son los huecos entre extents usados
+  std::vector<const BlockExtent *> used;
+  for (const BlockExtent &e : extents)
+    if (e.capacity > 0) used.push_back(&e);
+  std::sort(used.begin(), used.end(), [](const BlockExtent *a, const BlockExtent *b) {
+    return a->offset < b->offset;
+  });
+
+  free_extents.clear();
+  lz_end = 0;
+  for (const BlockExtent *e : used) {
+    if (e->offset > lz_end)
+      free_extents[lz_end] = static_cast<uint32_t>(e->offset - lz_end);
+    lz_end = std::max(lz_end, e->offset + e->capacity);
+  }
+}
+
+void Disk::closeCompressed() {
+  if (lz_fd != -1) ::close(lz_fd);
+  if (lz_map_fd != -1) ::close(lz_map_fd);
+  lz_fd = lz_map_fd = -1;
+  extents.clear();
+  free_extents.clear();
+  lz_end = 0;
+}
+
+// Primer hueco libre que alcance; si no hay, se agrega al final del archivo
+uint64_t Disk::allocateExtent(uint32_t capacity) {
+  for (auto it = free_extents.begin(); it != free_extents.end(); ++it) {
+    if (it->second < capacity) continue;
+    uint64_t offset = it->first;
+    uint32_t remaining = it->second - capacity;
+    free_extents.erase(it);
+    if (remaining > 0) free_extents[offset + capacity] = remaining;
+    return offset;
+  }
+  uint64_t offset = lz_end;
+  lz_end += capacity;
+  return offset;
+}
+
+void Disk::releaseExtent(uint64_t offset, uint32_t capacity) {
+  auto next = free_extents.lower_bound(offset);
+  if (next != free_extents.end() && next->first == offset + capacity) {
+    capacity += next->second;
+    next = free_extents.erase(next);
+  }
+  if (next != free_extents.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      capacity += prev->second;
+      free_extents.erase(prev);
+    }
+  }
+  if (offset + capacity == lz_end)
+    lz_end = offset;
+  else
+    free_extents[offset] = capacity;
+}
+
+void Disk::openImage() {
+  if (image_fd != -1) return;
+  if (direct_io) {
+    // Algunos sistemas de archivos (tmpfs) rechazan O_DIRECT al abrir y otros
+    // recien en la primera lectura; se prueba con el bloque 0
+    image_fd = ::open(image_path.c_str(), O_RDWR | O_DIRECT);
+    if (image_fd >= 0 && ::pread(image_fd, bounceBuffer(block_size), block_size, 0) < 0) {
+      ::close(image_fd);
+      image_fd = -1;
+    }
+    if (image_fd < 0) {
+      std::cerr << "E/S directa no soportada para " << image_path
+                << "; se usa la cache del sistema" << std::endl;
+      direct_io = false;
+    }
+  }
+  if (image_fd == -1) image_fd = ::open(image_path.c_str(), O_RDWR);
+  if (image_fd < 0)
+    throw std::runtime_error("No se pudo abrir la imagen de disco: " + image_path);
+}
+
+void Disk::closeImage() {
+  if (image_fd != -1) {
+    ::close(image_fd);
+    image_fd = -1;
+  }
+}
+
+void Disk::mapImage() {
+  if (image_map) return;
+  image_map_size = static_cast<size_t>(totalBlocks()) * block_size;
+  void *addr = ::mmap(nullptr, image_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, image_fd, 0);
+  if (addr == MAP_FAILED)
+    throw std::runtime_error(std::string("No se pudo mapear la imagen: ") + std::strerror(errno));
+  image_map = static_cast<char *>(addr);
+}
+
+void Disk::unmapImage() {
+  if (image_map) {
+    ::munmap(image_map, image_map_size);
+    image_map = nullptr;
+    image_map_size = 0;
+  }
+}
+
+bool Disk::setDirectIO(bool enable) {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  if (enable == direct_io) return true;
+  if (enable && backend != BACKEND_IMAGE) {
+    std::cerr << "La E/S directa solo esta disponible con backend=image" << std::endl;
+    return false;
+  }
+  if (enable && block_size % 512 != 0) {
+    std::cerr << "La E/S directa requiere bloques multiplo de 512 bytes" << std::endl;
+    return false;
+  }
+
+  closeImage();
+  direct_io = enable;
+  openImage();
+  return direct_io == enable;
+}
+
+// Descarta las paginas de la imagen de la cache del kernel, para que la
+// siguiente lectura vaya al disco
+void Disk::dropCache() {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  for (int fd : {image_fd, lz_fd}) {
+    if (fd == -1) continue;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  }
+}
+
+void Disk::sync() {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  if (image_map) ::msync(image_map, image_map_size, MS_SYNC);
+  for (int fd : {image_fd, lz_fd, lz_map_fd})
+    if (fd != -1) ::fdatasync(fd);
+}
+
+char *Disk::bounceBuffer(size_t len) {
+  if (bounce.size() < len) bounce.resize(len);
+  return bounce.data();
+}
+
+bool Disk::needsBounce(const char *buffer) const {
+  return direct_io && reinterpret_cast<uintptr_t>(buffer) % IO_ALIGNMENT != 0;
+}
+
+// El orden importa para sobrevivir a una caida: se copia al destino, se baja
+// a disco, recien entonces disk.cfg pasa a apuntar al destino y al final se
+// borra el origen. Si se corta antes del cambio de disk.cfg el origen sigue
+// intacto y la conversion se repite al reiniciar.
+void Disk::convertBackend(DiskBackend from, DiskBackend to, const std::string &config_path) {
+  // image y mmap comparten el mismo archivo, solo cambia como se accede
+  auto storage = [](DiskBackend b) { return b == BACKEND_MMAP ? BACKEND_IMAGE : b; };
+  DiskBackend source = storage(from);
+  DiskBackend target = storage(to);
+  if (source == target) {
+    saveConfig(config_path, disk_config);
+    backend = to;
+    return;
+  }
+
+  std::cout << "Convirtiendo disco de " << backendLabel(source) << " a "
+            << backendLabel(target) << "..." << std::endl;
+
+  if (source == BACKEND_IMAGE) openImage();
+  if (source == BACKEND_COMPRESSED) openCompressed();
+  std::vector<int> blocks = materializedBlocks(source);
+
+  // Restos de una conversion anterior que no llego a terminar
+  removeStorage(target);
+  if (target == BACKEND_DIRS) {
+    createStructure();
+  } else if (target == BACKEND_IMAGE) {
+    createImage();
+    openImage();
+  } else {
+    createCompressed();
+    openCompressed();
+  }
+
+  std::vector<char> buffer(block_size);
+  for (int i : blocks) {
+    readFrom(source, i, buffer.data());
+    writeTo(target, i, buffer.data());
+  }
+
+  syncStorage(target);
+  saveConfig(config_path, disk_config);
+  removeStorage(source);
+
+  backend = to;
+  std::cout << "Conversion completada: " << blocks.size() << " bloques." << std::endl;
+}
+
+// Fuerza a disco lo escrito en un backend; a diferencia de sync(), un error
+// se reporta porque de esto depende poder borrar el origen de una conversion
+void Disk::syncStorage(DiskBackend which) {
+  bool ok = true;
+  if (which == BACKEND_DIRS) {
+    // Los sectores se escriben con ofstream, sin descriptor a mano: se baja
+    // todo el sistema de archivos que contiene la raiz
+    int fd = ::open(root_path.c_str(), O_RDONLY | O_DIRECTORY);
+    ok = fd >= 0 && ::syncfs(fd) == 0;
+    if (fd >= 0) ::close(fd);
+  } else if (which == BACKEND_COMPRESSED) {
+    ok = ::fdatasync(lz_fd) == 0 && ::fdatasync(lz_map_fd) == 0;
+  } else {
+    if (image_map) ok = ::msync(image_map, image_map_size, MS_SYNC) == 0;
+    ok = ok && ::fdatasync(image_fd) == 0;
+  }
+  if (!ok)
+    throw std::runtime_error(std::string("No se pudo sincronizar el backend ") +
+                             backendLabel(which) + ": " + std::strerror(errno));
+}
+
+// Borra los archivos de un backend (image y mmap comparten la imagen)
+void Disk::removeStorage(DiskBackend which) {
+  if (which == BACKEND_DIRS) {
+    for (int plato = 0; plato < num_platos; ++plato)
+      fs::remove_all(fs::path(root_path) / ("plato" + std::to_string(plato)));
+  } else if (which == BACKEND_COMPRESSED) {
+    closeCompressed();
+    fs::remove(lz_path);
+    fs::remove(lz_map_path);
+  } else {
+    closeImage();
+    fs::remove(image_path);
+  }
+}
+
+// Bloques que tienen algo escrito en el backend dado, en orden. En
+// directorios son los que tienen algun archivo de sector; en la imagen, los
+// que no caen en un hueco del archivo disperso; comprimido, los que tienen
+// extent.
+std::vector<int> Disk::materializedBlocks(DiskBackend from) const {
+  std::vector<int> blocks;
+  int blocks_per_pista = num_sectores / sectors_per_block;
+
+  if (from == BACKEND_DIRS) {
+    auto number = [](const fs::path &p, const std::string &prefix) {
+      std::string name = p.filename().string();
+      if (name.rfind(prefix, 0) != 0) return -1;
+      try {
+        return std::stoi(name.substr(prefix.size()));
+      } catch (const std::exception &) {
+        return -1;
       }
+    };
+
+    for (const auto &entry : fs::recursive_directory_iterator(root_path)) {
+      if (!entry.is_regular_file()) continue;
+      fs::path sector_path = entry.path();
+      fs::path pista_path = sector_path.parent_path();
+      fs::path superficie_path = pista_path.parent_path();
+      fs::path plato_path = superficie_path.parent_path();
+
+      int sector = number(sector_path, "sector");
+      int pista = number(pista_path, "pista");
+      int superficie = number(superficie_path, "superficie");
+      int plato = number(plato_path, "plato");
+      if (sector < 0 || pista < 0 || superficie < 0 || plato < 0) continue;
+
+      int block = ((plato * num_superficies + superficie) * num_pistas + pista) *
+                      blocks_per_pista + sector / sectors_per_block;
+      if (block < totalBlocks()) blocks.push_back(block);
     }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+  }
+
+  if (from == BACKEND_COMPRESSED) {
+    for (size_t i = 0; i < extents.size(); ++i)
+      if (extents[i].length > 0) blocks.push_back(static_cast<int>(i));
+    return blocks;
   }
+
+  off_t end = static_cast<off_t>(totalBlocks()) * block_size;
+  off_t offset = 0;
+  while (offset < end) {
+    off_t data = ::lseek(image_fd, offset, SEEK_DATA);
+    if (data < 0) break; // ENXIO: no queda nada escrito
+    off_t hole = ::lseek(image_fd, data, SEEK_HOLE);
+    if (hole < 0 || hole > end) hole = end;
+    for (off_t b = data / block_size; b * block_size < hole; ++b)
+      blocks.push_back(static_cast<int>(b));
+    offset = hole;
+  }
+  return blocks;
 }
 
-SectorPos Disk::sectorStartOfBlock(int block_idx) {
+SectorPos Disk::sectorStartOfBlock(int block_idx) const {
   int blocks_per_pista = num_sectores / sectors_per_block;
   int blocks_per_superficie = blocks_per_pista * num_pistas;
   int blocks_per_plato = blocks_per_superficie * num_superficies;
@@ -140,44 +660,418 @@ SectorPos Disk::sectorStartOfBlock(int block_idx) {
   return {plato, superficie, pista, sector_inicial};
 }
 
+// Dos bloques son contiguos si el segundo empieza en el sector siguiente al
+// ultimo del primero, dentro de la misma pista
+bool Disk::blocksAreAdjacent(int first, int second) const {
+  if (second != first + 1) return false;
+  SectorPos a = sectorStartOfBlock(first);
+  SectorPos b = sectorStartOfBlock(second);
+  return a.plato == b.plato && a.superficie == b.superficie &&
+         a.pista == b.pista && b.sector == a.sector + sectors_per_block;
+}
+
+int Disk::totalBlocks() const {
+  return (num_platos * num_superficies * num_pistas * num_sectores) / sectors_per_block;
+}
+
 std::vector<char> Disk::readBlock(int block_idx) {
-  SectorPos pos = sectorStartOfBlock(block_idx);
   std::vector<char> data(block_size);
+  readBlockInto(block_idx, data.data());
+  return data;
+}
 
-  for (int i = 0; i < sectors_per_block; ++i) {
-    std::string sector_file = fs::path(root_path) /
-                              ("plato" + std::to_string(pos.plato)) /
-                              ("superficie" + std::to_string(pos.superficie)) /
-                              ("pista" + std::to_string(pos.pista)) /
-                              ("sector" + std::to_string(pos.sector + i));
+// Sin vector intermedio: el buffer pool lee directo en el frame
+void Disk::readBlockInto(int block_idx, char *dst) {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  auto start = std::chrono::steady_clock::now();
+  readFrom(backend, block_idx, dst);
+  read_latency.record(elapsedNs(start));
+  countBlock(block_idx, false);
+}
 
-    std::ifstream ifs(sector_file, std::ios::binary);
-    if (!ifs) throw std::runtime_error("Sector no encontrado: " + sector_file);
+void Disk::writeBlock(int block_idx, const std::vector<char> &data) {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  if ((int)data.size() != block_size)
+    throw std::runtime_error("Tamaño de bloque incorrecto");
+
+  auto start = std::chrono::steady_clock::now();
+  writeTo(backend, block_idx, data.data());
+  write_latency.record(elapsedNs(start));
+  countBlock(block_idx, true);
+}
+
+// Todo acceso pasa por readFrom/writeTo: el rango se valida aca una sola vez
+// para cualquier backend (en dirs un bloque fuera de rango se leeria como ceros)
+void Disk::checkBlock(int block_idx) const {
+  if (block_idx < 0 || block_idx >= totalBlocks())
+    throw std::out_of_range("Bloque fuera de rango: " + std::to_string(block_idx));
+}
 
-    ifs.read(&data[i * sector_size], sector_size);
+void Disk::readFrom(DiskBackend from, int block_idx, char *dst) {
+  checkBlock(block_idx);
+  if (from == BACKEND_DIRS)
+    readFromDirs(block_idx, dst);
+  else if (from == BACKEND_COMPRESSED)
+    readFromCompressed(block_idx, dst);
+  else
+    readFromImage(block_idx, dst);
+}
+
+void Disk::writeTo(DiskBackend to, int block_idx, const char *src) {
+  checkBlock(block_idx);
+  if (to == BACKEND_DIRS)
+    writeToDirs(block_idx, src);
+  else if (to == BACKEND_COMPRESSED)
+    writeToCompressed(block_idx, src);
+  else
+    writeToImage(block_idx, src);
+}
+
+// Ordena los pedidos por bloque y los agrupa en corridas fisicamente contiguas.
+// Cada corrida guarda posiciones dentro de block_ids.
+std::vector<std::vector<size_t>> Disk::physicalRuns(const std::vector<int> &block_ids) const {
+  std::vector<size_t> order(block_ids.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return block_ids[a] < block_ids[b];
+  });
+
+  std::vector<std::vector<size_t>> runs;
+  for (size_t idx : order) {
+    if (!runs.empty() && blocksAreAdjacent(block_ids[runs.back().back()], block_ids[idx]))
+      runs.back().push_back(idx);
+    else
+      runs.push_back({idx});
   }
+  return runs;
+}
 
-  return data;
+void Disk::readRun(const std::vector<int> &block_ids, const std::vector<size_t> &run,
+                   const std::vector<char *> &buffers) {
+  int first = block_ids[run.front()];
+  int last = block_ids[run.back()];
+  if (backend == BACKEND_DIRS || backend == BACKEND_COMPRESSED || image_map ||
+      run.size() == 1 || first < 0 || last >= totalBlocks()) {
+    for (size_t idx : run)
+      readFrom(backend, block_ids[idx], buffers[idx]);
+    return;
+  }
+
+  off_t offset = static_cast<off_t>(first) * block_size;
+  if (std::any_of(run.begin(), run.end(), [&](size_t idx) { return needsBounce(buffers[idx]); })) {
+    char *tmp = bounceBuffer(run.size() * block_size);
+    preadAll(image_fd, tmp, run.size() * block_size, offset);
+    for (size_t i = 0; i < run.size(); ++i)
+      std::memcpy(buffers[run[i]], tmp + i * block_size, block_size);
+    return;
+  }
+
+  std::vector<iovec> iov(run.size());
+  for (size_t i = 0; i < run.size(); ++i)
+    iov[i] = {buffers[run[i]], static_cast<size_t>(block_size)};
+  preadvAll(image_fd, iov, offset);
 }
 
-void Disk::writeBlock(int block_idx, const std::vector<char> &data) {
-  if ((int)data.size() != block_size)
-    throw std::runtime_error("Tamaño de bloque incorrecto");
+void Disk::writeRun(const std::vector<int> &block_ids, const std::vector<size_t> &run,
+                    const std::vector<const char *> &buffers) {
+  int first = block_ids[run.front()];
+  int last = block_ids[run.back()];
+  if (backend == BACKEND_DIRS || backend == BACKEND_COMPRESSED || image_map ||
+      run.size() == 1 || first < 0 || last >= totalBlocks()) {
+    for (size_t idx : run)
+      writeTo(backend, block_ids[idx], buffers[idx]);
+    return;
+  }
+
+  off_t offset = static_cast<off_t>(first) * block_size;
+  if (std::any_of(run.begin(), run.end(), [&](size_t idx) { return needsBounce(buffers[idx]); })) {
+    char *tmp = bounceBuffer(run.size() * block_size);
+    for (size_t i = 0; i < run.size(); ++i)
+      std::memcpy(tmp + i * block_size, buffers[run[i]], block_size);
+    pwriteAll(image_fd, tmp, run.size() * block_size, offset);
+    return;
+  }
+
+  std::vector<iovec> iov(run.size());
+  for (size_t i = 0; i < run.size(); ++i)
+    iov[i] = {const_cast<char *>(buffers[run[i]]), static_cast<size_t>(block_size)};
+  pwritevAll(image_fd, iov, offset);
+}
+
+std::vector<bool> Disk::readBlocks(const std::vector<int> &block_ids,
+                                   const std::vector<char *> &buffers) {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  if (block_ids.size() != buffers.size())
+    throw std::invalid_argument("readBlocks: cantidad de bloques y buffers no coincide");
+
+  std::vector<bool> status(block_ids.size(), false);
+  for (const auto &run : physicalRuns(block_ids)) {
+    try {
+      auto start = std::chrono::steady_clock::now();
+      readRun(block_ids, run, buffers);
+      read_latency.record(elapsedNs(start));
+      for (size_t idx : run) {
+        status[idx] = true;
+        countBlock(block_ids[idx], false);
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error leyendo bloques desde " << block_ids[run.front()]
+                << ": " << e.what() << std::endl;
+    }
+  }
+  return status;
+}
+
+std::vector<bool> Disk::writeBlocks(const std::vector<int> &block_ids,
+                                    const std::vector<const char *> &buffers) {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  if (block_ids.size() != buffers.size())
+    throw std::invalid_argument("writeBlocks: cantidad de bloques y buffers no coincide");
+
+  std::vector<bool> status(block_ids.size(), false);
+  for (const auto &run : physicalRuns(block_ids)) {
+    try {
+      auto start = std::chrono::steady_clock::now();
+      writeRun(block_ids, run, buffers);
+      write_latency.record(elapsedNs(start));
+      for (size_t idx : run) {
+        status[idx] = true;
+        countBlock(block_ids[idx], true);
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error escribiendo bloques desde " << block_ids[run.front()]
+                << ": " << e.what() << std::endl;
+    }
+  }
+  return status;
+}
 
+int Disk::trackIndex(int block_idx) const {
+  SectorPos pos = sectorStartOfBlock(block_idx);
+  return (pos.plato * num_superficies + pos.superficie) * num_pistas + pos.pista;
+}
+
+// Se llama solo despues de una E/S exitosa (ya validada por checkBlock); el
+// chequeo evita indexar track_stats fuera de rango si algun camino no valida
+void Disk::countBlock(int block_idx, bool write) {
+  if (block_idx < 0 || block_idx >= totalBlocks()) return;
+  TrackStats &t = track_stats[trackIndex(block_idx)];
+  if (write) {
+    ++t.writes;
+    t.bytes_written += block_size;
+  } else {
+    ++t.reads;
+    t.bytes_read += block_size;
+  }
+}
+
+void Disk::resetIOStats() {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  std::fill(track_stats.begin(), track_stats.end(), TrackStats{});
+  read_latency.reset();
+  write_latency.reset();
+}
+
+// Las latencias son por operacion fisica: un bloque suelto o una corrida
+// contigua de readBlocks/writeBlocks
+void Disk::printIOStats() const {
+  std::lock_guard<std::mutex> lock(io_mutex);
+  static constexpr size_t TOP_PISTAS = 10;
+
+  auto latency = [](const char *label, const LatencyHistogram &h) {
+    std::cout << label << h.count() << " ops";
+    if (h.count() > 0)
+      std::cout << " | p50 " << h.percentile(0.50) / 1000.0 << " us, p99 "
+                << h.percentile(0.99) / 1000.0 << " us, max " << h.max() / 1000.0
+                << " us";
+    std::cout << std::endl;
+  };
+
+  TrackStats total;
+  std::vector<TrackStats> per_plato(num_platos);
+  for (size_t i = 0; i < track_stats.size(); ++i) {
+    const TrackStats &t = track_stats[i];
+    TrackStats &p = per_plato[i / (num_superficies * num_pistas)];
+    for (TrackStats *acc : {&total, &p}) {
+      acc->reads += t.reads;
+      acc->writes += t.writes;
+      acc->bytes_read += t.bytes_read;
+      acc->bytes_written += t.bytes_written;
+    }
+  }
+
+  std::cout << "==== Estadisticas de E/S ====" << std::endl;
+  std::cout << "Bloques leidos     : " << total.reads << " (" << total.bytes_read << " bytes)"
+            << std::endl;
+  std::cout << "Bloques escritos   : " << total.writes << " (" << total.bytes_written
+            << " bytes)" << std::endl;
+  latency("Latencia lectura   : ", read_latency);
+  latency("Latencia escritura : ", write_latency);
+  if (total.reads + total.writes == 0) return;
+
+  std::cout << std::endl << "Por plato:" << std::endl;
+  std::cout << std::left << std::setw(8) << "Plato" << std::setw(10) << "Lecturas"
+            << std::setw(12) << "Escrituras" << "Bytes" << std::endl;
+  for (int plato = 0; plato < num_platos; ++plato) {
+    const TrackStats &p = per_plato[plato];
+    if (p.reads + p.writes == 0) continue;
+    std::cout << std::setw(8) << plato << std::setw(10) << p.reads << std::setw(12)
+              << p.writes << p.bytes_read + p.bytes_written << std::endl;
+  }
+
+  std::vector<size_t> order;
+  for (size_t i = 0; i < track_stats.size(); ++i)
+    if (track_stats[i].reads + track_stats[i].writes > 0) order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return track_stats[a].reads + track_stats[a].writes >
+           track_stats[b].reads + track_stats[b].writes;
+  });
+  if (order.size() > TOP_PISTAS) order.resize(TOP_PISTAS);
+
+  std::cout << std::endl << "Pistas mas activas:" << std::endl;
+  std::cout << std::setw(8) << "Plato" << std::setw(12) << "Superficie" << std::setw(8)
+            << "Pista" << std::setw(10) << "Lecturas" << std::setw(12) << "Escrituras"
+            << "Bytes" << std::endl;
+  for (size_t i : order) {
+    const TrackStats &t = track_stats[i];
+    int pista = i % num_pistas;
+    int superficie = (i / num_pistas) % num_superficies;
+    int plato = i / (num_pistas * num_superficies);
+    std::cout << std::setw(8) << plato << std::setw(12) << superficie << std::setw(8)
+              << pista << std::setw(10) << t.reads << std::setw(12) << t.writes
+              << t.bytes_read + t.bytes_written << std::endl;
+  }
+  std::cout << std::right;
+}
+
+// Puntero de solo lectura al bloque dentro del mapeo; nullptr si el backend
+// no es mmap. Sigue siendo valido mientras el disco exista.
+const char *Disk::blockView(int block_idx) const {
+  if (!image_map || block_idx < 0 || block_idx >= totalBlocks())
+    return nullptr;
+  return image_map + static_cast<size_t>(block_idx) * block_size;
+}
+
+std::string Disk::sectorFile(const SectorPos &pos, int offset) const {
+  return fs::path(root_path) /
+         ("plato" + std::to_string(pos.plato)) /
+         ("superficie" + std::to_string(pos.superficie)) /
+         ("pista" + std::to_string(pos.pista)) /
+         ("sector" + std::to_string(pos.sector + offset));
+}
+
+void Disk::readFromDirs(int block_idx, char *dst) {
   SectorPos pos = sectorStartOfBlock(block_idx);
 
   for (int i = 0; i < sectors_per_block; ++i) {
-    std::string sector_file = fs::path(root_path) /
-                              ("plato" + std::to_string(pos.plato)) /
-                              ("superficie" + std::to_string(pos.superficie)) /
-                              ("pista" + std::to_string(pos.pista)) /
-                              ("sector" + std::to_string(pos.sector + i));
+    std::string sector_file = sectorFile(pos, i);
+
+    std::ifstream ifs(sector_file, std::ios::binary);
+    if (!ifs) {
+      // Sector nunca escrito
+      if (!fs::exists(sector_file)) {
+        std::memset(dst + i * sector_size, 0, sector_size);
+        continue;
+      }
+      throw std::runtime_error("Sector no encontrado: " + sector_file);
+    }
+
+    ifs.read(dst + i * sector_size, sector_size);
+  }
+}
+
+void Disk::writeToDirs(int block_idx, const char *src) {
+  SectorPos pos = sectorStartOfBlock(block_idx);
+
+  for (int i = 0; i < sectors_per_block; ++i) {
+    std::string sector_file = sectorFile(pos, i);
 
     std::ofstream ofs(sector_file, std::ios::binary);
-    if (!ofs) throw std::runtime_error("Sector no encontrado: " + sector_file);
+    if (!ofs) {
+      // Primera escritura en esta pista: crear sus directorios
+      fs::create_directories(fs::path(sector_file).parent_path());
+      ofs.open(sector_file, std::ios::binary);
+      if (!ofs) throw std::runtime_error("No se pudo crear el sector: " + sector_file);
+    }
+
+    ofs.write(src + i * sector_size, sector_size);
+  }
+}
+
+// En la imagen el bloque N ocupa [N * block_size, (N + 1) * block_size), en el
+// mismo orden plato/superficie/pista/sector que sectorStartOfBlock
+void Disk::readFromImage(int block_idx, char *dst) {
+  if (image_map) {
+    std::memcpy(dst, image_map + static_cast<size_t>(block_idx) * block_size, block_size);
+    return;
+  }
+  off_t offset = static_cast<off_t>(block_idx) * block_size;
+  if (needsBounce(dst)) {
+    char *tmp = bounceBuffer(block_size);
+    preadAll(image_fd, tmp, block_size, offset);
+    std::memcpy(dst, tmp, block_size);
+    return;
+  }
+  preadAll(image_fd, dst, block_size, offset);
+}
 
-    ofs.write(&data[i * sector_size], sector_size);
+void Disk::writeToImage(int block_idx, const char *src) {
+  if (image_map) {
+    std::memcpy(image_map + static_cast<size_t>(block_idx) * block_size, src, block_size);
+    return;
   }
+  off_t offset = static_cast<off_t>(block_idx) * block_size;
+  if (needsBounce(src)) {
+    char *tmp = bounceBuffer(block_size);
+    std::memcpy(tmp, src, block_size);
+    src = tmp;
+  }
+  pwriteAll(image_fd, src, block_size, offset);
+}
+
+void Disk::readFromCompressed(int block_idx, char *dst) {
+  const BlockExtent &e = extents[block_idx];
+  if (e.length == 0) {
+    std::memset(dst, 0, block_size);
+    return;
+  }
+
+  if (e.length == static_cast<uint32_t>(block_size)) {
+    preadAll(lz_fd, dst, block_size, e.offset);
+  } else {
+    lz_scratch.resize(e.length);
+    preadAll(lz_fd, lz_scratch.data(), e.length, e.offset);
+    if (!BlockCodec::decompress(lz_scratch.data(), e.length, dst, block_size))
+      throw std::runtime_error("Bloque comprimido corrupto: " + std::to_string(block_idx));
+  }
+  ++lz_blocks_read;
+  lz_bytes_read += e.length;
+}
+
+// Si el bloque ya no entra en su extent se reubica; si comprimido no ocupa
+// menos que block_size se guarda tal cual
+void Disk::writeToCompressed(int block_idx, const char *src) {
+  BlockCodec::compress(src, block_size, lz_scratch);
+  const char *payload = lz_scratch.data();
+  uint32_t length = static_cast<uint32_t>(lz_scratch.size());
+  if (length >= static_cast<uint32_t>(block_size)) {
+    payload = src;
+    length = block_size;
+  }
+
+  BlockExtent &e = extents[block_idx];
+  if (length > e.capacity) {
+    if (e.capacity > 0) releaseExtent(e.offset, e.capacity);
+    e.capacity = (length + EXTENT_UNIT - 1) / EXTENT_UNIT * EXTENT_UNIT;
+    e.offset = allocateExtent(e.capacity);
+  }
+  e.length = length;
+
+  pwriteAll(lz_fd, payload, length, e.offset);
+  pwriteAll(lz_map_fd, reinterpret_cast<const char *>(&e), sizeof(BlockExtent),
+            static_cast<off_t>(block_idx) * sizeof(BlockExtent));
+  ++lz_blocks_written;
+  lz_bytes_written += length;
 }
 
 void Disk::printBlockPosition(int block_idx) {
@@ -218,13 +1112,38 @@ void Disk::printDiskInfo() const {
   std::cout << "Sector size: " << sector_size << " bytes" << std::endl;
   std::cout << "Sectores por bloque: " << sectors_per_block << std::endl;
 
-  int total_blocks = (num_platos * num_superficies * num_pistas * num_sectores) / sectors_per_block;
+  int total_blocks = totalBlocks();
 
+  std::cout << "Backend: " << disk_config.backend << std::endl;
   std::cout << "Total de bloques: " << total_blocks << std::endl;
   std::cout << "Tamaño de bloque: " << block_size << " bytes" << std::endl;
   std::cout << "Capacidad total (MB): "
             << static_cast<double>(total_blocks * block_size) / (1024.0 * 1024.0)
             << std::endl;
 
-  system("tree disk");
+  if (backend == BACKEND_DIRS) {
+    system(("tree " + root_path).c_str());
+  } else if (backend == BACKEND_COMPRESSED) {
+    uint64_t stored = 0, free_bytes = 0;
+    int written = 0;
+    for (const BlockExtent &e : extents) {
+      if (e.length == 0) continue;
+      stored += e.length;
+      ++written;
+    }
+    for (const auto &hole : free_extents) free_bytes += hole.second;
+    double logical = static_cast<double>(written) * block_size;
+
+    std::cout << "Imagen comprimida: " << lz_path << " (" << lz_end << " bytes, "
+              << free_bytes << " libres)" << std::endl;
+    std::cout << "Bloques escritos: " << written << ", " << stored << " de "
+              << static_cast<uint64_t>(logical) << " bytes (ratio "
+              << (stored > 0 ? logical / stored : 0.0) << ")" << std::endl;
+    std::cout << "Leidos: " << lz_blocks_read << " bloques, " << lz_bytes_read
+              << " bytes | Escritos: " << lz_blocks_written << " bloques, "
+              << lz_bytes_written << " bytes" << std::endl;
+  } else
+    std::cout << "Imagen: " << image_path
+              << (image_map ? " (mapeada en memoria)" : "")
+              << (direct_io ? " (E/S directa)" : "") << std::endl;
 }
@@ -1,8 +1,41 @@
 #pragma once
 
+#include "histogram.h"
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
 #include <string>
 #include <vector>
 
+// Con direct_io=1 el kernel exige que la memoria de cada E/S este alineada
+constexpr size_t IO_ALIGNMENT = 4096;
+
+// Bloques de metadatos a escribir completos (bloque -> contenido); se juntan
+// para registrarlos en el WAL antes de llevarlos al disco
+using BlockImages = std::map<int, std::vector<char>>;
+
+template <typename T> struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U> AlignedAllocator(const AlignedAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    void *p = nullptr;
+    if (posix_memalign(&p, IO_ALIGNMENT, n * sizeof(T)) != 0) throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+  void deallocate(T *p, size_t) { free(p); }
+
+  template <typename U> bool operator==(const AlignedAllocator<U> &) const { return true; }
+  template <typename U> bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+// Memoria de un bloque (frames del buffer pool)
+using BlockBuffer = std::vector<char, AlignedAllocator<char>>;
+
 struct SectorPos {
   int plato;
   int superficie;
@@ -10,6 +43,8 @@ struct SectorPos {
   int sector;
 };
 
+enum DiskBackend { BACKEND_DIRS, BACKEND_IMAGE, BACKEND_MMAP, BACKEND_COMPRESSED };
+
 class Disk {
 public:
   std::string root_path;
@@ -29,7 +64,11 @@ public:
     int sectores;
     int sector_size;
     int sectors_per_block;
+    std::string backend = "dirs";
+    // Claves que no son geometria (tiempos, buffer, etc.)
+    std::map<std::string, std::string> options;
 
+    // Solo la geometria obliga a recrear el disco; el backend se convierte
     bool operator==(const DiskConfig &other) const {
       return platos == other.platos && pistas == other.pistas &&
              sectores == other.sectores && sector_size == other.sector_size &&
@@ -42,22 +81,138 @@ public:
   };
 
   DiskConfig disk_config;
+  DiskBackend backend;
+
+  // Opciones leidas siempre del disk.cfg externo
+  int intOption(const std::string &key, int default_value) const;
+  std::string stringOption(const std::string &key, const std::string &default_value) const;
 
   // Configuracion y estructura
   bool loadConfig(const std::string &path, DiskConfig &cfg);
   void saveConfig(const std::string &path, const DiskConfig &cfg);
   bool configChanged(const DiskConfig &a, const DiskConfig &b);
   bool directoryIsComplete();
-  Disk(const std::string &root, const std::string &config);
+  bool imageIsComplete();
+  bool compressedIsComplete();
+  // overrides pisa opciones del disk.cfg (no la geometria): flags --clave=valor
+  Disk(const std::string &root, const std::string &config,
+       const std::map<std::string, std::string> &overrides = {});
+  ~Disk();
+  Disk(const Disk &) = delete;
+  Disk &operator=(const Disk &) = delete;
   void createStructure();
+  void createImage();
+  void createCompressed();
+  // Copia el contenido al nuevo backend; config_path recibe disk_config
+  // (con el backend nuevo) antes de borrar el viejo
+  void convertBackend(DiskBackend from, DiskBackend to, const std::string &config_path);
+  void syncStorage(DiskBackend which);
+  void removeStorage(DiskBackend which);
 
   // Acceso a bloques logicos
   std::vector<char> readBlock(int block_idx);
+  void readBlockInto(int block_idx, char *dst); // dst con block_size bytes
   void writeBlock(int block_idx, const std::vector<char> &data);
+  const char *blockView(int block_idx) const;
+
+  // Acceso por lotes: agrupa bloques fisicamente contiguos en una sola E/S.
+  // Devuelve el estado de cada bloque en el mismo orden de la entrada.
+  std::vector<bool> readBlocks(const std::vector<int> &block_ids,
+                               const std::vector<char *> &buffers);
+  std::vector<bool> writeBlocks(const std::vector<int> &block_ids,
+                                const std::vector<const char *> &buffers);
+
+  // E/S directa (O_DIRECT) sobre la imagen: los bloques no pasan por la
+  // cache del kernel, asi el buffer pool es la unica copia en memoria
+  bool directIO() const { return direct_io; }
+  bool setDirectIO(bool enable);
+  void dropCache();
+
+  // Lleva al medio lo escrito (fdatasync/msync). En directorios cada sector
+  // se cierra al escribirse y no hay un descriptor que sincronizar.
+  void sync();
+
+  // Instrumentacion: operaciones y bytes por pista, latencia de cada E/S
+  void printIOStats() const;
+  void resetIOStats();
 
   // Utilidades
-  SectorPos sectorStartOfBlock(int block_idx);
+  SectorPos sectorStartOfBlock(int block_idx) const;
+  bool blocksAreAdjacent(int first, int second) const;
+  int totalBlocks() const;
   void printBlockPosition(int block_idx);
   std::string getBlockPosition(int block_idx);
   void printDiskInfo() const;
+
+private:
+  std::string image_path;
+  int image_fd = -1;
+  char *image_map = nullptr;
+  size_t image_map_size = 0;
+  bool direct_io = false;
+  BlockBuffer bounce;
+  // Las lecturas anticipadas del buffer manager llegan desde otro hilo; la
+  // E/S de bloques, las estadisticas y el bounce buffer se usan de a uno
+  mutable std::mutex io_mutex;
+
+  struct TrackStats {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+  };
+  std::vector<TrackStats> track_stats;
+  LatencyHistogram read_latency;
+  LatencyHistogram write_latency;
+
+  // backend=compressed: disk.lz guarda cada bloque comprimido en un extent de
+  // largo variable y disk.map tiene un BlockExtent por bloque
+  struct BlockExtent {
+    uint64_t offset;
+    uint32_t length; // 0 = nunca escrito, block_size = guardado sin comprimir
+    uint32_t capacity;
+  };
+  static constexpr uint32_t EXTENT_UNIT = 64;
+  std::string lz_path;
+  std::string lz_map_path;
+  int lz_fd = -1;
+  int lz_map_fd = -1;
+  std::vector<BlockExtent> extents;
+  std::map<uint64_t, uint32_t> free_extents;
+  uint64_t lz_end = 0;
+  std::vector<char> lz_scratch;
+  uint64_t lz_blocks_read = 0;
+  uint64_t lz_bytes_read = 0;
+  uint64_t lz_blocks_written = 0;
+  uint64_t lz_bytes_written = 0;
+
+  void applyConfig(const DiskConfig &cfg);
+  void openImage();
+  void closeImage();
+  void mapImage();
+  void unmapImage();
+  int trackIndex(int block_idx) const;
+  void countBlock(int block_idx, bool write);
+  void openCompressed();
+  void closeCompressed();
+  uint64_t allocateExtent(uint32_t capacity);
+  void releaseExtent(uint64_t offset, uint32_t capacity);
+  char *bounceBuffer(size_t len);
+  bool needsBounce(const char *buffer) const;
+  std::string sectorFile(const SectorPos &pos, int offset) const;
+  void readFromDirs(int block_idx, char *dst);
+  void writeToDirs(int block_idx, const char *src);
+  void readFromImage(int block_idx, char *dst);
+  void writeToImage(int block_idx, const char *src);
+  void readFromCompressed(int block_idx, char *dst);
+  void writeToCompressed(int block_idx, const char *src);
+  void checkBlock(int block_idx) const;
+  void readFrom(DiskBackend from, int block_idx, char *dst);
+  void writeTo(DiskBackend to, int block_idx, const char *src);
+  std::vector<int> materializedBlocks(DiskBackend from) const;
+  std::vector<std::vector<size_t>> physicalRuns(const std::vector<int> &block_ids) const;
+  void readRun(const std::vector<int> &block_ids, const std::vector<size_t> &run,
+               const std::vector<char *> &buffers);
+  void writeRun(const std::vector<int> &block_ids, const std::vector<size_t> &run,
+                const std::vector<const char *> &buffers);
 };
@@ -0,0 +1,64 @@
+#include "extents.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Indice del ultimo extent que empieza en block o antes (list.size() si no hay)
+size_t ExtentList::findExtent(int block) const {
+  auto it = std::upper_bound(
+      list.begin(), list.end(), block,
+      [](int b, const Extent &e) { return b < e.start; });
+  return it == list.begin() ? list.size() : (it - list.begin()) - 1;
+}
+
+void ExtentList::renumberFrom(size_t extent) {
+  first_pos.resize(list.size());
+  for (size_t i = extent; i < list.size(); ++i)
+    first_pos[i] = i == 0 ? 0 : first_pos[i - 1] + list[i - 1].length;
+  count = list.empty() ? 0 : first_pos.back() + list.back().length;
+}
+
+void ExtentList::add(int block) { addExtent(block, 1); }
+
+void ExtentList::addExtent(int start, int length) {
+  if (length <= 0)
+    return;
+  int end = start + length;
+
+  size_t i = findExtent(start);
+  if (i == list.size())
+    i = 0;
+  else if (list[i].start + list[i].length < start)
+    ++i;
+
+  // Desde i, los extents que se solapan o tocan [start, end) se absorben
+  size_t j = i;
+  while (j < list.size() && list[j].start <= end) {
+    start = std::min(start, list[j].start);
+    end = std::max(end, list[j].start + list[j].length);
+    ++j;
+  }
+  list.erase(list.begin() + i, list.begin() + j);
+  list.insert(list.begin() + i, Extent{start, end - start});
+  renumberFrom(i);
+}
+
+void ExtentList::clear() {
+  list.clear();
+  first_pos.clear();
+  count = 0;
+}
+
+int ExtentList::at(size_t pos) const {
+  if (pos >= count)
+    throw std::out_of_range("ExtentList: posición fuera de rango");
+  size_t i = std::upper_bound(first_pos.begin(), first_pos.end(), pos) -
+             first_pos.begin() - 1;
+  return list[i].start + (pos - first_pos[i]);
+}
+
+int ExtentList::indexOf(int block) const {
+  size_t i = findExtent(block);
+  if (i == list.size() || block >= list[i].start + list[i].length)
+    return -1;
+  return first_pos[i] + (block - list[i].start);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct Extent {
+  int start;
+  int length;
+};
+
+// Bloques de una relacion como corridas (inicio, largo) ordenadas por
+// posicion fisica. Las corridas adyacentes se fusionan al agregar, asi el
+// tamaño crece con la fragmentacion y no con la cantidad de bloques.
+class ExtentList {
+public:
+  class const_iterator {
+  public:
+    const_iterator(const std::vector<Extent> *list, size_t extent, int offset)
+        : list(list), extent(extent), offset(offset) {}
+
+    int operator*() const { return (*list)[extent].start + offset; }
+    const_iterator &operator++() {
+      if (++offset == (*list)[extent].length) {
+        ++extent;
+        offset = 0;
+      }
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const {
+      return extent == o.extent && offset == o.offset;
+    }
+    bool operator!=(const const_iterator &o) const { return !(*this == o); }
+
+  private:
+    const std::vector<Extent> *list;
+    size_t extent;
+    int offset;
+  };
+
+  const_iterator begin() const { return {&list, 0, 0}; }
+  const_iterator end() const { return {&list, list.size(), 0}; }
+
+  void add(int block);
+  void addExtent(int start, int length);
+  void clear();
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  int back() const { return list.back().start + list.back().length - 1; }
+  int at(size_t pos) const;
+  int indexOf(int block) const;
+  const std::vector<Extent> &extents() const { return list; }
+
+private:
+  std::vector<Extent> list;
+  std::vector<size_t> first_pos; // posicion del primer bloque de cada extent
+  size_t count = 0;
+
+  size_t findExtent(int block) const;
+  void renumberFrom(size_t extent);
+};
@@ -0,0 +1,42 @@
+#include "framearena.h"
+#include "disk.h"
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+
+static size_t roundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+FrameArena::FrameArena(int frame_count, int block_size, size_t alignment, bool huge_pages) {
+  stride = roundUp(block_size, alignment);
+  length = stride * std::max(1, frame_count);
+
+  void *addr = MAP_FAILED;
+  if (huge_pages) {
+    length = roundUp(length, HUGE_PAGE_SIZE);
+    addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) kind = PAGES_HUGETLB;
+  }
+  if (addr == MAP_FAILED) {
+    addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && ::madvise(addr, length, MADV_HUGEPAGE) == 0) kind = PAGES_THP;
+#endif
+  }
+  base = static_cast<char *>(addr);
+}
+
+FrameArena::~FrameArena() {
+  if (base) ::munmap(base, length);
+}
+
+const char *FrameArena::pageKindName() const {
+  switch (kind) {
+  case PAGES_HUGETLB: return "hugetlb";
+  case PAGES_THP: return "THP (madvise)";
+  default: return "normales";
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+// Memoria de todos los frames de un shard en una sola reserva anonima. Cada
+// frame empieza alineado a alignment y el paso entre frames es block_size
+// redondeado a ese multiplo. Con E/S directa el shard pide IO_ALIGNMENT (lo
+// exige O_DIRECT); sin ella, CACHE_LINE, asi un bloque chico no ocupa una
+// pagina entera ni se desperdicia casi la mitad del pool. Con huge_pages se
+// intenta MAP_HUGETLB (paginas reservadas en /proc/sys/vm/nr_hugepages) y, si
+// no hay, se pide THP con madvise; un fallo de madvise no es un error.
+class FrameArena {
+public:
+  enum PageKind { PAGES_NORMAL, PAGES_HUGETLB, PAGES_THP };
+
+  static constexpr size_t CACHE_LINE = 64;
+
+  FrameArena(int frame_count, int block_size, size_t alignment, bool huge_pages);
+  ~FrameArena();
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  char *frame(int idx) const { return base + static_cast<size_t>(idx) * stride; }
+  size_t bytes() const { return length; }
+  size_t frameStride() const { return stride; }
+  PageKind pageKind() const { return kind; }
+  const char *pageKindName() const;
+
+private:
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  char *base = nullptr;
+  size_t stride = 0;
+  size_t length = 0;
+  PageKind kind = PAGES_NORMAL;
+};
@@ -0,0 +1,146 @@
+#include "fsm.h"
+#include "allocator.h"
+#include <algorithm>
+#include <cstring>
+
+FreeSpaceMap::FreeSpaceMap(Disk &disk_) : disk(disk_) {}
+
+// Categoria 0: lleno. Categoria c >= 1: al menos (c-1)*block_size/14 bytes
+int FreeSpaceMap::category(int free_bytes) const {
+  if (free_bytes <= 0)
+    return 0;
+  return std::min(15, 1 + free_bytes * 14 / disk.block_size);
+}
+
+// Categoria minima que garantiza needed_bytes libres (0 = cualquier hueco)
+int FreeSpaceMap::minCategory(int needed_bytes) const {
+  if (needed_bytes <= 0)
+    return 1;
+  return 1 + (needed_bytes * 14 + disk.block_size - 1) / disk.block_size;
+}
+
+int FreeSpaceMap::entriesPerBlock() const {
+  return (disk.block_size - CHAIN_HEADER) * 2;
+}
+
+bool FreeSpaceMap::load(const Relation &rel) {
+  Entry entry;
+  std::vector<char> data(disk.block_size);
+
+  int block = rel.fsm_block;
+  while (block != -1) {
+    if (block < 0 || block >= disk.totalBlocks() ||
+        std::find(entry.storage.begin(), entry.storage.end(), block) !=
+            entry.storage.end())
+      break;
+    disk.readBlockInto(block, data.data());
+    int next, count;
+    std::memcpy(&next, &data[0], 4);
+    std::memcpy(&count, &data[4], 4);
+    if (count < 0 || count > entriesPerBlock())
+      break;
+    for (int i = 0; i < count; ++i) {
+      uint8_t byte = data[CHAIN_HEADER + i / 2];
+      entry.categories.push_back(i % 2 ? byte >> 4 : byte & 0x0f);
+    }
+    entry.storage.push_back(block);
+    block = next;
+  }
+
+  bool valid = rel.fsm_block != -1 && block == -1 &&
+               entry.categories.size() == rel.blocks.size();
+  if (!valid) {
+    // Se reconstruye desde los bloques; la cadena vieja se reaprovecha
+    entry.categories.assign(rel.blocks.size(), 0);
+    entry.dirty = true;
+  }
+  entries[rel.name] = std::move(entry);
+  return valid;
+}
+
+void FreeSpaceMap::save(Relation &rel, Allocator &allocator) {
+  auto it = entries.find(rel.name);
+  if (it == entries.end() || !it->second.dirty)
+    return;
+  Entry &entry = it->second;
+
+  int per_block = entriesPerBlock();
+  size_t needed = std::max<size_t>(
+      1, (entry.categories.size() + per_block - 1) / per_block);
+  while (entry.storage.size() < needed) {
+    int block = allocator.allocateIndex();
+    if (block == -1)
+      return;
+    entry.storage.push_back(block);
+  }
+
+  for (size_t b = 0; b < entry.storage.size(); ++b) {
+    std::vector<char> data(disk.block_size, 0);
+    int next = b + 1 < entry.storage.size() ? entry.storage[b + 1] : -1;
+    size_t first = b * per_block;
+    int count = std::min<size_t>(per_block,
+                                 entry.categories.size() -
+                                     std::min(first, entry.categories.size()));
+    std::memcpy(&data[0], &next, 4);
+    std::memcpy(&data[4], &count, 4);
+    for (int i = 0; i < count; ++i)
+      data[CHAIN_HEADER + i / 2] |= entry.categories[first + i] << (i % 2 ? 4 : 0);
+    disk.writeBlock(entry.storage[b], data);
+  }
+
+  rel.fsm_block = entry.storage[0];
+  entry.dirty = false;
+}
+
+void FreeSpaceMap::drop(const std::string &relation) {
+  entries.erase(relation);
+}
+
+std::vector<int> FreeSpaceMap::storageBlocks(const std::string &relation) const {
+  auto it = entries.find(relation);
+  return it == entries.end() ? std::vector<int>{} : it->second.storage;
+}
+
+// Si la relacion tiene un bloque mas que el mapa, es block, recien agregado:
+// se abre su entrada en la posicion fisica que le toca
+void FreeSpaceMap::update(const Relation &rel, int block, int free_bytes) {
+  Entry &entry = entries[rel.name];
+  int pos = rel.blocks.indexOf(block);
+  if (pos == -1)
+    return;
+  if (entry.categories.size() < rel.blocks.size()) {
+    entry.categories.insert(entry.categories.begin() + pos, 0);
+    entry.dirty = true;
+    for (int &hint : entry.hints)
+      if (pos < hint)
+        ++hint;
+  }
+
+  uint8_t cat = category(free_bytes);
+  if (entry.categories[pos] == cat)
+    return;
+  entry.categories[pos] = cat;
+  entry.dirty = true;
+  for (int c = 1; c <= cat; ++c)
+    entry.hints[c] = std::min(entry.hints[c], pos);
+}
+
+// Primer bloque con al menos min_cat desde hints[min_cat]. Los bloques que no
+// alcanzan hacen avanzar ese hint y solo un update con mas espacio lo hace
+// retroceder, asi que en una carga que solo agrega al final la busqueda es
+// O(1) amortizada aunque los bloques "llenos" conserven algunos bytes.
+int FreeSpaceMap::findBlock(const Relation &rel, int needed_bytes) {
+  auto it = entries.find(rel.name);
+  if (it == entries.end() || it->second.categories.empty())
+    return -1;
+  Entry &entry = it->second;
+  int min_cat = minCategory(needed_bytes);
+  if (min_cat >= CATEGORIES)
+    return -1;
+  int n = entry.categories.size();
+
+  int &hint = entry.hints[min_cat];
+  while (hint < n && entry.categories[hint] < min_cat)
+    ++hint;
+  return hint < n ? rel.blocks.at(hint) : -1;
+}
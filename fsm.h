@@ -0,0 +1,55 @@
+#pragma once
+
+#include "catalog.h"
+#include "disk.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Allocator;
+
+// Mapa de espacio libre por relacion: 4 bits por bloque con una categoria
+// gruesa de bytes libres (0 = lleno). Sirve para elegir el bloque de un
+// insert sin recorrer la relacion entera por el buffer pool.
+//
+// Es solo una pista: si una categoria quedo vieja (p. ej. tras una caida) el
+// insert falla en ese bloque, se corrige la categoria y se busca otro.
+//
+// En disco cada relacion tiene una cadena de bloques de la region de indices
+// que empieza en Relation::fsm_block. Cada bloque guarda el siguiente de la
+// cadena, la cantidad de entradas y las categorias en el orden fisico de
+// rel.blocks.
+class FreeSpaceMap {
+public:
+  FreeSpaceMap(Disk &disk);
+
+  bool load(const Relation &rel);
+  void save(Relation &rel, Allocator &allocator);
+  void drop(const std::string &relation);
+  std::vector<int> storageBlocks(const std::string &relation) const;
+
+  void update(const Relation &rel, int block, int free_bytes);
+  int findBlock(const Relation &rel, int needed_bytes);
+
+private:
+  static constexpr int CATEGORIES = 16;
+
+  struct Entry {
+    std::vector<uint8_t> categories; // por posicion en rel.blocks
+    std::vector<int> storage;
+    // hints[c]: antes de esa posicion no hay bloques de categoria >= c
+    std::array<int, CATEGORIES> hints{};
+    bool dirty = false;
+  };
+
+  static constexpr int CHAIN_HEADER = 8;
+
+  Disk &disk;
+  std::unordered_map<std::string, Entry> entries;
+
+  int category(int free_bytes) const;
+  int minCategory(int needed_bytes) const;
+  int entriesPerBlock() const;
+};
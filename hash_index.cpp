@@ -1,8 +1,9 @@
 #include "hash_index.h"
-#include "bitmap.h"
+#include "allocator.h"
 #include "disk.h"
 #include <algorithm>
 #include <cstring>
+#include <stdexcept>
 
 // Inicialización del mapa estático
 std::map<std::string, HashIndex> HashIndex::indices;
@@ -78,12 +79,11 @@ void HashIndex::deserializeBucket(Bucket &bucket,
 }
 
 // Crea un índice nuevo para una relación
-void HashIndex::createForRelation(const std::string &relation_name, Disk &disk,
-                                  Bitmap &bitmap, int key_size,
+void HashIndex::createForRelation(const std::string &relation_name,
+                                  Allocator &allocator, int key_size,
                                   int bucket_capacity) {
   // Reservar bloque de cabecera
-  int header_block = bitmap.getFreeBlock();
-  bitmap.set(header_block, true);
+  int header_block = allocator.allocateIndex();
 
   // Inicializar directorio y buckets
   int global_depth = 1;
@@ -92,8 +92,7 @@ void HashIndex::createForRelation(const std::string &relation_name, Disk &disk,
 
   // Crear dos buckets iniciales
   for (int i = 0; i < 2; ++i) {
-    int bucket_block = bitmap.getFreeBlock();
-    bitmap.set(bucket_block, true);
+    int bucket_block = allocator.allocateIndex();
     directory[i] = bucket_block;
     Bucket b;
     b.local_depth = 1;
@@ -108,13 +107,14 @@ void HashIndex::createForRelation(const std::string &relation_name, Disk &disk,
   idx.bucket_capacity = bucket_capacity;
   idx.directory = directory;
   idx.buckets = buckets;
-  idx.saveToDisk(disk);
+  idx.dirty_blocks.insert(header_block);
+  idx.dirty_blocks.insert(directory.begin(), directory.end());
   indices[relation_name] = idx;
 }
 
 // Inserta una entrada en el índice
 void HashIndex::insert(const std::string &key, int block_idx, int offset,
-                       Disk &disk, Bitmap &bitmap) {
+                       Disk &disk, Allocator &allocator) {
   uint32_t h = hashKey(key);
   int dir_idx = h & ((1 << global_depth) - 1);
   int bucket_block = directory[dir_idx];
@@ -129,18 +129,18 @@ void HashIndex::insert(const std::string &key, int block_idx, int offset,
   // Insertar
   if ((int)bucket.entries.size() < bucket_capacity) {
     bucket.entries.push_back({key, block_idx, offset});
-    saveToDisk(disk);
+    dirty_blocks.insert(bucket_block);
     return;
   }
 
   // Si está lleno, dividir
-  splitBucket(dir_idx, bitmap);
+  splitBucket(dir_idx, allocator);
   // Reintentar la inserción
-  insert(key, block_idx, offset, disk, bitmap);
+  insert(key, block_idx, offset, disk, allocator);
 }
 
 // Divide un bucket lleno
-void HashIndex::splitBucket(int dir_idx, Bitmap &bitmap) {
+void HashIndex::splitBucket(int dir_idx, Allocator &allocator) {
   int old_bucket_block = directory[dir_idx];
   Bucket &old_bucket = buckets[old_bucket_block];
   int old_local_depth = old_bucket.local_depth;
@@ -156,8 +156,7 @@ void HashIndex::splitBucket(int dir_idx, Bitmap &bitmap) {
   }
 
   // Crear nuevo bucket
-  int new_bucket_block = bitmap.getFreeBlock();
-  bitmap.set(new_bucket_block, true);
+  int new_bucket_block = allocator.allocateIndex();
   Bucket new_bucket;
   new_bucket.local_depth = old_local_depth + 1;
 
@@ -191,6 +190,7 @@ void HashIndex::splitBucket(int dir_idx, Bitmap &bitmap) {
   }
 
   buckets[new_bucket_block] = new_bucket;
+  dirty_blocks.insert({header_block, old_bucket_block, new_bucket_block});
 }
 
 // Busca todas las referencias para una clave
@@ -223,24 +223,26 @@ void HashIndex::remove(const std::string &key, int block_idx, int offset) {
       });
   if (it != bucket.entries.end()) {
     bucket.entries.erase(it, bucket.entries.end());
+    dirty_blocks.insert(bucket_block);
   }
 }
 
-// Serializa el índice completo a disco
-void HashIndex::saveToDisk(Disk &disk) const {
-  // Guardar cabecera
-  std::vector<char> header_data;
-  serializeHeader(header_data);
-  header_data.resize(disk.block_size, 0);
-  disk.writeBlock(header_block, header_data);
-
-  // Guardar todos los buckets
-  for (const auto &[block, bucket] : buckets) {
-    std::vector<char> bucket_data;
-    serializeBucket(bucket, bucket_data);
-    bucket_data.resize(disk.block_size, 0);
-    disk.writeBlock(block, bucket_data);
+// Serializa solo la cabecera y los buckets que cambiaron
+void HashIndex::saveDirty(Disk &disk, BlockImages &pages) {
+  for (int block : dirty_blocks) {
+    std::vector<char> data;
+    if (block == header_block) {
+      serializeHeader(data);
+    } else {
+      auto it = buckets.find(block);
+      if (it == buckets.end())
+        continue;
+      serializeBucket(it->second, data);
+    }
+    data.resize(disk.block_size, 0);
+    pages[block] = std::move(data);
   }
+  dirty_blocks.clear();
 }
 
 // Carga el índice desde disco
@@ -251,10 +253,11 @@ void HashIndex::loadFromDisk(Disk &disk) {
 
   // Leer todos los buckets
   buckets.clear();
+  std::vector<char> bucket_data(disk.block_size);
   for (int block : directory) {
     if (buckets.count(block))
       continue; // Ya cargado
-    std::vector<char> bucket_data = disk.readBlock(block);
+    disk.readBlockInto(block, bucket_data.data());
     Bucket b;
     deserializeBucket(b, bucket_data);
     buckets[block] = b;
@@ -273,9 +276,8 @@ void HashIndex::loadAllFromDisk(
   }
 }
 
-// Guarda todos los índices a disco
-void HashIndex::saveAllToDisk(Disk &disk) {
+void HashIndex::saveAll(Disk &disk, BlockImages &pages) {
   for (auto &[rel, idx] : indices) {
-    idx.saveToDisk(disk);
+    idx.saveDirty(disk, pages);
   }
 }
@@ -1,7 +1,9 @@
 #pragma once
+#include "disk.h"
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 #include <cstdint>
 
 struct HashEntry {
@@ -15,8 +17,7 @@ struct Bucket {
     std::vector<HashEntry> entries;
 };
 
-class Bitmap;
-class Disk;
+class Allocator;
 
 class HashIndex {
 public:
@@ -24,16 +25,17 @@ public:
 
     static void loadAllFromDisk(Disk& disk, const std::map<std::string, int>& relation_to_block);
 
-    static void saveAllToDisk(Disk& disk);
+    // Deja en pages la cabecera y los buckets que cambiaron en cada indice
+    static void saveAll(Disk& disk, BlockImages& pages);
 
-    static void createForRelation(const std::string& relation_name, Disk& disk, Bitmap& bitmap, int key_size, int bucket_capacity);
+    static void createForRelation(const std::string& relation_name, Allocator& allocator, int key_size, int bucket_capacity);
 
-    void insert(const std::string& key, int block_idx, int offset, Disk& disk, Bitmap& bitmap);
+    void insert(const std::string& key, int block_idx, int offset, Disk& disk, Allocator& allocator);
     void remove(const std::string& key, int block_idx, int offset);
     std::vector<std::pair<int, int>> search(const std::string& key) const;
 
     void loadFromDisk(Disk& disk);
-    void saveToDisk(Disk& disk) const;
+    void saveDirty(Disk& disk, BlockImages& pages);
 
     int getHeaderBlock() const { return header_block; }
 
@@ -45,9 +47,10 @@ public:
     int bucket_capacity;
     std::vector<int> directory; // directorio: hash -> bloque de bucket
     std::map<int, Bucket> buckets; // bloque -> bucket en memoria
+    std::set<int> dirty_blocks; // cabecera y buckets cambiados desde el ultimo guardado
 
     uint32_t hashKey(const std::string& key) const;
-    void splitBucket(int dir_idx, Bitmap& bitmap);
+    void splitBucket(int dir_idx, Allocator& allocator);
     void serializeHeader(std::vector<char>& data) const;
     void deserializeHeader(const std::vector<char>& data);
     void serializeBucket(const Bucket& bucket, std::vector<char>& data) const;
@@ -0,0 +1,45 @@
+#include "histogram.h"
+#include <algorithm>
+
+int LatencyHistogram::bucketOf(uint64_t ns) {
+  if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+  int msb = 63 - __builtin_clzll(ns);
+  int sub = static_cast<int>((ns >> (msb - 2)) & (SUB_BUCKETS - 1));
+  return (msb - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpper(int bucket) {
+  if (bucket < SUB_BUCKETS) return bucket;
+  int msb = bucket / SUB_BUCKETS + 1;
+  uint64_t sub = bucket % SUB_BUCKETS;
+  uint64_t lower = (SUB_BUCKETS + sub) << (msb - 2);
+  return lower + (uint64_t(1) << (msb - 2)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+  ++buckets[bucketOf(ns)];
+  ++total;
+  sum_ns += ns;
+  max_ns = std::max(max_ns, ns);
+}
+
+void LatencyHistogram::reset() {
+  buckets.fill(0);
+  total = sum_ns = max_ns = 0;
+}
+
+double LatencyHistogram::mean() const {
+  return total ? static_cast<double>(sum_ns) / total : 0.0;
+}
+
+// Cota superior del sub-rango donde cae el percentil p (0..1)
+uint64_t LatencyHistogram::percentile(double p) const {
+  if (total == 0) return 0;
+  uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(p * total + 0.999999));
+  uint64_t seen = 0;
+  for (int b = 0; b < BUCKETS; ++b) {
+    seen += buckets[b];
+    if (seen >= target) return std::min(bucketUpper(b), max_ns);
+  }
+  return max_ns;
+}
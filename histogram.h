@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Histograma de latencias en nanosegundos. Cada potencia de dos se divide en
+// 4 sub-rangos, asi el error de un percentil queda por debajo del 25%.
+class LatencyHistogram {
+public:
+  void record(uint64_t ns);
+  void reset();
+
+  uint64_t count() const { return total; }
+  uint64_t max() const { return max_ns; }
+  double mean() const;
+  uint64_t percentile(double p) const;
+
+private:
+  static constexpr int SUB_BUCKETS = 4;
+  static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+  std::array<uint64_t, BUCKETS> buckets{};
+  uint64_t total = 0;
+  uint64_t sum_ns = 0;
+  uint64_t max_ns = 0;
+
+  static int bucketOf(uint64_t ns);
+  static uint64_t bucketUpper(int bucket);
+};
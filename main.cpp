@@ -1,7 +1,22 @@
 #include "shell.h"
+#include <iostream>
+#include <map>
 
-int main() {
-  Disk disk("disk", "disk.cfg");
+// Flags --clave=valor: pisan las opciones del disk.cfg, p. ej.
+//   ./main --buffer_policy=arc --buffer_frames=256
+int main(int argc, char **argv) {
+  std::map<std::string, std::string> overrides;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos || eq == 2) {
+      std::cerr << "Uso: " << argv[0] << " [--clave=valor ...]" << std::endl;
+      return 1;
+    }
+    overrides[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+  }
+
+  Disk disk("disk", "disk.cfg", overrides);
   SGBD sgbd(disk);
   Shell shell(sgbd);
   shell.run();
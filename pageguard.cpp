@@ -0,0 +1,104 @@
+#include "pageguard.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+PageGuard::PageGuard(FrameRef ref_, int block_id_, bool exclusive_)
+    : ref(ref_), block_id(block_id_), exclusive(exclusive_) {
+  if (!ref.latch) return;
+  try {
+    if (exclusive)
+      ref.latch->lock();
+    else
+      ref.latch->lock_shared();
+  } catch (...) {
+    ref.shard->unfix(ref.frame, false, 0);
+    throw;
+  }
+}
+
+PageGuard::PageGuard(PageGuard &&other) noexcept { *this = std::move(other); }
+
+PageGuard &PageGuard::operator=(PageGuard &&other) noexcept {
+  if (this != &other) {
+    release();
+    ref = other.ref;
+    block_id = other.block_id;
+    exclusive = other.exclusive;
+    dirty = other.dirty;
+    lsn = other.lsn;
+    other.ref = FrameRef();
+    other.block_id = -1;
+    other.dirty = false;
+    other.lsn = 0;
+  }
+  return *this;
+}
+
+// El latch se suelta antes del pin: con pin_count a 0 el frame ya se puede
+// desalojar y nadie debe tenerlo tomado
+void PageGuard::release() {
+  if (ref.latch) {
+    if (exclusive)
+      ref.latch->unlock();
+    else
+      ref.latch->unlock_shared();
+  }
+  if (ref.shard) ref.shard->unfix(ref.frame, dirty, lsn);
+  ref = FrameRef();
+  block_id = -1;
+  dirty = false;
+  lsn = 0;
+}
+
+std::string_view PageGuard::text(int offset, int length) const {
+  if (offset < 0 || length < 0 || offset + length > ref.size)
+    throw std::out_of_range("Campo fuera del bloque");
+  return std::string_view(ref.data + offset, length);
+}
+
+int PageGuard::number(int offset, int length) const {
+  std::string_view field = text(offset, length);
+  size_t start = 0;
+  while (start < field.size() && std::isspace(static_cast<unsigned char>(field[start]))) ++start;
+  if (start < field.size() && field[start] == '+') ++start;
+  int value = 0;
+  auto [ptr, ec] = std::from_chars(field.data() + start, field.data() + field.size(), value);
+  if (ec == std::errc::invalid_argument) throw std::invalid_argument("Campo numerico vacio");
+  if (ec == std::errc::result_out_of_range) throw std::out_of_range("Campo numerico fuera de rango");
+  return value;
+}
+
+ReadPageGuard::ReadPageGuard(BufferManager &bm, int block_id_) : PageGuard(bm.fix(block_id_), block_id_, false) {}
+
+ReadPageGuard ReadPageGuard::view(BufferManager &bm, int block_id_) {
+  return ReadPageGuard(bm.fixView(block_id_), block_id_);
+}
+
+WritePageGuard::WritePageGuard(BufferManager &bm, int block_id_) : PageGuard(bm.fix(block_id_), block_id_, true) {}
+
+char *WritePageGuard::data() { return ref.data; }
+
+void WritePageGuard::put(int offset, std::string_view bytes) {
+  if (offset < 0 || offset + static_cast<int>(bytes.size()) > ref.size)
+    throw std::out_of_range("Escritura fuera del bloque");
+  std::memcpy(data() + offset, bytes.data(), bytes.size());
+}
+
+void WritePageGuard::markDirty(uint64_t lsn_) {
+  dirty = true;
+  lsn = std::max(lsn, lsn_);
+}
+
+ScanGuard::ScanGuard(BufferManager &bm_, const ExtentList &block_ids) : bm(&bm_) {
+  bm->beginScan(block_ids);
+}
+
+void ScanGuard::release() {
+  if (!bm) return;
+  BufferManager *pool = bm;
+  bm = nullptr;
+  pool->endScan();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "buffermanager.h"
+#include <cstdint>
+#include <string_view>
+
+// Guards RAII sobre un bloque del pool. Al construirse traen el bloque y lo
+// pinean (un solo lookup); al destruirse, o con release(), lo despinean.
+// Son el unico acceso a los bloques del pool: con el antiguo getBlock + pin
+// ... unpin un return o una excepcion a mitad dejaba el frame pineado.
+//
+// Un mismo hilo no debe tener dos guards sobre el mismo bloque a la vez: el
+// latch del frame no es reentrante. Hay que hacer release() antes de llamar a
+// algo que vuelva a pedir el bloque (updateFreeSpace, insert_var, ...).
+class PageGuard {
+public:
+  PageGuard() = default;
+  PageGuard(PageGuard &&other) noexcept;
+  PageGuard &operator=(PageGuard &&other) noexcept;
+  PageGuard(const PageGuard &) = delete;
+  PageGuard &operator=(const PageGuard &) = delete;
+  ~PageGuard() { release(); }
+
+  int blockId() const { return block_id; }
+  const char *data() const { return ref.data; }
+  int size() const { return ref.size; }
+  bool valid() const { return ref.data != nullptr; }
+
+  // Campos de texto de registros: text devuelve los bytes tal cual y number
+  // los interpreta como std::stoi (espacios delante, error si no hay digitos)
+  std::string_view text(int offset, int length) const;
+  int number(int offset, int length) const;
+
+  void release();
+
+protected:
+  PageGuard(FrameRef ref_, int block_id_, bool exclusive_);
+
+  FrameRef ref;
+  int block_id = -1;
+  bool exclusive = false;
+  bool dirty = false;
+  uint64_t lsn = 0;
+};
+
+// Lectura: latch compartido del frame. view() usa el mapeo del disco cuando
+// el bloque no esta en el pool, sin ocupar un frame (scans con backend=mmap).
+class ReadPageGuard : public PageGuard {
+public:
+  ReadPageGuard() = default;
+  ReadPageGuard(BufferManager &bm, int block_id_);
+  static ReadPageGuard view(BufferManager &bm, int block_id_);
+
+private:
+  ReadPageGuard(FrameRef ref_, int block_id_) : PageGuard(ref_, block_id_, false) {}
+};
+
+// Escritura: latch exclusivo. Los cambios se anotan con markDirty(lsn), con
+// el LSN del registro del WAL que los describe (SGBD::logChange lo hace); el
+// frame queda sucio con el LSN mayor al soltar el guard. Un guard que solo
+// leyo no ensucia el frame.
+class WritePageGuard : public PageGuard {
+public:
+  WritePageGuard() = default;
+  WritePageGuard(BufferManager &bm, int block_id_);
+
+  using PageGuard::data;
+  char *data();
+  void put(int offset, std::string_view bytes);
+  void markDirty(uint64_t lsn_ = 0);
+};
+
+// Recorrido secuencial de una relacion: beginScan al construirse y endScan al
+// destruirse o con release(). Una excepcion a mitad del recorrido (un registro
+// mal formado, una lectura fallida) ya no deja el anillo reservado.
+class ScanGuard {
+public:
+  ScanGuard(BufferManager &bm_, const ExtentList &block_ids);
+  ~ScanGuard() { release(); }
+  ScanGuard(const ScanGuard &) = delete;
+  ScanGuard &operator=(const ScanGuard &) = delete;
+
+  void release();
+
+private:
+  BufferManager *bm;
+};
@@ -0,0 +1,74 @@
+#include "prefetch.h"
+
+Prefetcher::Prefetcher(Disk &disk_) : disk(disk_), worker(&Prefetcher::run, this) {}
+
+// Termina las lecturas encoladas antes de salir: escriben en frames del pool
+Prefetcher::~Prefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_cv.notify_one();
+  worker.join();
+}
+
+void Prefetcher::submit(int block_id, char *dst) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({block_id, dst});
+    queued.insert(block_id);
+    ++in_flight;
+  }
+  work_cv.notify_one();
+}
+
+std::vector<std::pair<int, bool>> Prefetcher::takeCompleted() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::pair<int, bool>> result(done.begin(), done.end());
+  done.clear();
+  return result;
+}
+
+// Espera a que termine la lectura de un bloque encolado. No retira el
+// resultado: lo hace takeCompleted, con el latch del shard, que puede haberlo
+// retirado ya otro hilo
+void Prefetcher::wait(int block_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [&] { return queued.count(block_id) == 0; });
+}
+
+void Prefetcher::drain() {
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [&] { return in_flight == 0; });
+}
+
+void Prefetcher::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_cv.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (pending.empty()) return;
+
+    std::vector<int> ids;
+    std::vector<char *> buffers;
+    for (const Job &job : pending) {
+      ids.push_back(job.block_id);
+      buffers.push_back(job.dst);
+    }
+    pending.clear();
+    lock.unlock();
+
+    std::vector<bool> loaded(ids.size(), false);
+    try {
+      loaded = disk.readBlocks(ids, buffers);
+    } catch (...) {
+    }
+
+    lock.lock();
+    for (size_t i = 0; i < ids.size(); ++i) {
+      done[ids[i]] = loaded[i];
+      queued.erase(ids[i]);
+    }
+    in_flight -= static_cast<int>(ids.size());
+    done_cv.notify_all();
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "disk.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Hilo de E/S para lecturas anticipadas. El buffer manager elige el frame y
+// encola (bloque, destino); el hilo lee con Disk::readBlocks todo lo que haya
+// en la cola de una vez. Los resultados quedan hasta que se retiran con
+// takeCompleted; el frame destino no se puede tocar hasta entonces.
+class Prefetcher {
+public:
+  Prefetcher(Disk &disk_);
+  ~Prefetcher();
+  Prefetcher(const Prefetcher &) = delete;
+  Prefetcher &operator=(const Prefetcher &) = delete;
+
+  void submit(int block_id, char *dst);
+  std::vector<std::pair<int, bool>> takeCompleted();
+  void wait(int block_id);
+  void drain();
+
+private:
+  struct Job {
+    int block_id;
+    char *dst;
+  };
+
+  Disk &disk;
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  std::deque<Job> pending;
+  std::unordered_map<int, bool> done;
+  std::unordered_set<int> queued; // encolados o leyendose
+  int in_flight = 0; // encolados y aun sin resultado
+  bool stopping = false;
+  std::thread worker;
+
+  void run();
+};
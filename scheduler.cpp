@@ -0,0 +1,217 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+IOScheduler::IOScheduler(Disk &disk_) : disk(disk_), policy(SCHED_CLOOK) {
+  if (!setPolicy(disk.stringOption("io_sched", "clook")))
+    throw std::invalid_argument("Politica de planificacion no reconocida");
+
+  int rpm = disk.intOption("rpm", 7200);
+  rotation_ms = 60000.0 / std::max(rpm, 1);
+  sector_ms = rotation_ms / disk.num_sectores;
+  seek_base_ms = disk.intOption("seek_base_us", 1000) / 1000.0;
+  seek_pista_ms = disk.intOption("seek_pista_us", 100) / 1000.0;
+}
+
+void IOScheduler::submitRead(int block_idx, char *dst) {
+  std::lock_guard<std::mutex> lock(mutex);
+  queues[std::this_thread::get_id()].push_back({block_idx, false, dst});
+}
+
+void IOScheduler::submitWrite(int block_idx, const char *src) {
+  std::lock_guard<std::mutex> lock(mutex);
+  queues[std::this_thread::get_id()].push_back({block_idx, true, const_cast<char *>(src)});
+}
+
+void IOScheduler::readBlock(int block_idx, char *dst) {
+  submitRead(block_idx, dst);
+  if (!dispatch()[0])
+    throw std::runtime_error("No se pudo leer el bloque " + std::to_string(block_idx));
+}
+
+void IOScheduler::writeBlock(int block_idx, const char *src) {
+  submitWrite(block_idx, src);
+  if (!dispatch()[0])
+    throw std::runtime_error("No se pudo escribir el bloque " + std::to_string(block_idx));
+}
+
+// Para accesos que no pasan por la cola (p. ej. vistas mmap): solo se simula
+void IOScheduler::recordAccess(int block_idx) {
+  std::lock_guard<std::mutex> lock(mutex);
+  simulate(block_idx);
+}
+
+// Ordena la cola del hilo; el estado se devuelve en el orden en que se encolo.
+// La E/S real se hace fuera del mutex.
+std::vector<bool> IOScheduler::dispatch() {
+  std::vector<IORequest> queue;
+  std::vector<size_t> order;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = queues.find(std::this_thread::get_id());
+    if (it != queues.end()) {
+      queue = std::move(it->second);
+      queues.erase(it);
+    }
+    order = serviceOrder(queue);
+    for (size_t idx : order)
+      simulate(queue[idx].block_idx);
+  }
+
+  std::vector<bool> status(queue.size(), false);
+  execute(queue, order, status);
+  return status;
+}
+
+std::vector<size_t> IOScheduler::serviceOrder(const std::vector<IORequest> &queue) const {
+  std::vector<size_t> order(queue.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  if (policy == SCHED_FCFS) return order;
+
+  std::vector<SectorPos> pos(queue.size());
+  for (size_t i = 0; i < queue.size(); ++i)
+    pos[i] = disk.sectorStartOfBlock(queue[i].block_idx);
+
+  // Dentro de una pista (cilindro) se atiende por sector, luego plato/superficie
+  auto by_pista = [&](size_t a, size_t b) {
+    if (pos[a].pista != pos[b].pista) return pos[a].pista < pos[b].pista;
+    if (pos[a].sector != pos[b].sector) return pos[a].sector < pos[b].sector;
+    if (pos[a].plato != pos[b].plato) return pos[a].plato < pos[b].plato;
+    if (pos[a].superficie != pos[b].superficie) return pos[a].superficie < pos[b].superficie;
+    return a < b;
+  };
+  std::stable_sort(order.begin(), order.end(), by_pista);
+
+  // C-LOOK siempre sube; SCAN sigue la direccion actual del brazo
+  bool ascending = policy == SCHED_CLOOK || arm_ascending;
+  std::vector<size_t> sweep, back;
+  for (size_t i : order) {
+    bool ahead = ascending ? pos[i].pista >= arm_pista : pos[i].pista <= arm_pista;
+    (ahead ? sweep : back).push_back(i);
+  }
+
+  // Recorrer pistas en orden descendente sin alterar el orden dentro de cada una
+  auto descending = [&](std::vector<size_t> &v) {
+    std::stable_sort(v.begin(), v.end(), [&](size_t a, size_t b) {
+      return pos[a].pista > pos[b].pista;
+    });
+  };
+  if (policy == SCHED_SCAN) {
+    if (ascending)
+      descending(back);
+    else
+      descending(sweep);
+  }
+
+  sweep.insert(sweep.end(), back.begin(), back.end());
+  return sweep;
+}
+
+void IOScheduler::simulate(int block_idx) {
+  SectorPos target = disk.sectorStartOfBlock(block_idx);
+
+  int distance = std::abs(target.pista - arm_pista);
+  double seek = distance == 0 ? 0.0 : seek_base_ms + distance * seek_pista_ms;
+  if (target.pista != arm_pista) arm_ascending = target.pista > arm_pista;
+  arm_pista = target.pista;
+  clock_ms += seek;
+
+  // Sector que pasa bajo el cabezal en este instante
+  double angle = std::fmod(clock_ms, rotation_ms) / sector_ms;
+  double wait_sectors = std::fmod(target.sector - angle + disk.num_sectores, disk.num_sectores);
+  if (wait_sectors > disk.num_sectores - 1e-6) wait_sectors = 0; // error de redondeo
+  double rotation = wait_sectors * sector_ms;
+  double transfer = disk.sectors_per_block * sector_ms;
+  clock_ms += rotation + transfer;
+
+  for (ServiceStats *stats : {&query_stats, &total_stats}) {
+    stats->requests++;
+    stats->seek_pistas += distance;
+    stats->seek_ms += seek;
+    stats->rotation_ms += rotation;
+    stats->transfer_ms += transfer;
+  }
+}
+
+// Ejecuta en el orden planificado, agrupando pedidos consecutivos del mismo
+// tipo para que Disk pueda unir los bloques contiguos
+void IOScheduler::execute(const std::vector<IORequest> &queue, const std::vector<size_t> &order,
+                          std::vector<bool> &status) {
+  size_t i = 0;
+  while (i < order.size()) {
+    bool write = queue[order[i]].write;
+    size_t j = i;
+    std::vector<int> ids;
+    std::vector<char *> read_buffers;
+    std::vector<const char *> write_buffers;
+    while (j < order.size() && queue[order[j]].write == write) {
+      ids.push_back(queue[order[j]].block_idx);
+      if (write)
+        write_buffers.push_back(queue[order[j]].buffer);
+      else
+        read_buffers.push_back(queue[order[j]].buffer);
+      ++j;
+    }
+
+    std::vector<bool> done = write ? disk.writeBlocks(ids, write_buffers)
+                                   : disk.readBlocks(ids, read_buffers);
+    for (size_t k = 0; k < done.size(); ++k)
+      status[order[i + k]] = done[k];
+    i = j;
+  }
+}
+
+bool IOScheduler::setPolicy(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (name == "fcfs") policy = SCHED_FCFS;
+  else if (name == "scan") policy = SCHED_SCAN;
+  else if (name == "clook") policy = SCHED_CLOOK;
+  else return false;
+  return true;
+}
+
+std::string IOScheduler::policyName() const {
+  switch (policy) {
+  case SCHED_FCFS: return "fcfs";
+  case SCHED_SCAN: return "scan";
+  default: return "clook";
+  }
+}
+
+void IOScheduler::resetQueryStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  query_stats = ServiceStats{};
+}
+
+void IOScheduler::printQueryStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (query_stats.requests == 0) return;
+  std::cout << std::fixed << std::setprecision(2)
+            << "[E/S simulada] " << query_stats.requests << " peticiones, "
+            << query_stats.seek_pistas << " pistas recorridas, "
+            << query_stats.totalMs() << " ms (seek " << query_stats.seek_ms
+            << ", rotacion " << query_stats.rotation_ms << ", transferencia "
+            << query_stats.transfer_ms << ")\n";
+}
+
+void IOScheduler::printInfo() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::cout << "=== Planificador de E/S ===\n";
+  std::cout << "Politica        : " << policyName() << "\n";
+  std::cout << std::fixed << std::setprecision(3)
+            << "Rotacion        : " << rotation_ms << " ms/vuelta\n"
+            << "Seek            : " << seek_base_ms << " ms + "
+            << seek_pista_ms << " ms/pista\n";
+  std::cout << "Brazo en pista  : " << arm_pista
+            << (arm_ascending ? " (subiendo)" : " (bajando)") << "\n";
+  std::cout << std::setprecision(2)
+            << "Peticiones      : " << total_stats.requests << "\n"
+            << "Pistas recorridas: " << total_stats.seek_pistas << "\n"
+            << "Tiempo simulado : " << total_stats.totalMs() << " ms\n";
+  if (total_stats.requests > 0)
+    std::cout << "Promedio        : "
+              << total_stats.totalMs() / total_stats.requests << " ms/peticion\n";
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "disk.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum SchedulingPolicy { SCHED_FCFS, SCHED_SCAN, SCHED_CLOOK };
+
+struct IORequest {
+  int block_idx;
+  bool write;
+  char *buffer; // destino en lecturas, origen en escrituras
+};
+
+struct ServiceStats {
+  int requests = 0;
+  long long seek_pistas = 0;
+  double seek_ms = 0;
+  double rotation_ms = 0;
+  double transfer_ms = 0;
+
+  double totalMs() const { return seek_ms + rotation_ms + transfer_ms; }
+};
+
+// Cola de peticiones delante de Disk. Ordena por pista (FCFS, SCAN o C-LOOK)
+// y simula el brazo y la rotacion para estimar el tiempo de servicio.
+// Cada hilo encola en su propia cola y dispatch atiende solo la del hilo que
+// llama; el brazo simulado y las estadisticas se comparten bajo un mutex.
+class IOScheduler {
+public:
+  IOScheduler(Disk &disk_);
+
+  void submitRead(int block_idx, char *dst);
+  void submitWrite(int block_idx, const char *src);
+  std::vector<bool> dispatch();
+
+  void readBlock(int block_idx, char *dst);
+  void writeBlock(int block_idx, const char *src);
+  void recordAccess(int block_idx);
+
+  bool setPolicy(const std::string &name);
+  std::string policyName() const;
+
+  void resetQueryStats();
+  void printQueryStats() const;
+  void printInfo() const;
+
+private:
+  Disk &disk;
+  SchedulingPolicy policy;
+  mutable std::mutex mutex;
+  std::unordered_map<std::thread::id, std::vector<IORequest>> queues;
+
+  // Modelo mecanico
+  double rotation_ms;
+  double sector_ms;
+  double seek_base_ms;
+  double seek_pista_ms;
+  int arm_pista = 0;
+  bool arm_ascending = true;
+  double clock_ms = 0;
+
+  ServiceStats query_stats;
+  ServiceStats total_stats;
+
+  std::vector<size_t> serviceOrder(const std::vector<IORequest> &queue) const;
+  void simulate(int block_idx);
+  void execute(const std::vector<IORequest> &queue, const std::vector<size_t> &order,
+               std::vector<bool> &status);
+};
@@ -23,28 +23,44 @@ static std::string trim(const std::string &s) {
   return s.substr(start, end - start);
 }
 
-SGBD::SGBD(Disk &disk_) : disk(disk_), bitmap(disk_), catalog(disk_) {
-
-  std::string policy;
-  int frame_count;
-
-  while (true) {
-    std::cout << "Seleccione política de reemplazo (lru / clock): ";
-    std::cin >> policy;
-    if (policy == "lru" || policy == "clock")
+SGBD::SGBD(Disk &disk_)
+    : disk(disk_), bitmap(disk_), allocator(disk_, bitmap), fsm(disk_),
+      catalog(disk_, allocator), scheduler(disk_), wal(disk_),
+      checkpointer(*this) {
+
+  // buffer_policy y buffer_frames (disk.cfg o --buffer_policy=...) evitan las
+  // preguntas; sin ellas se piden por la entrada como siempre
+  std::string policy = disk.stringOption("buffer_policy", "");
+  int frame_count = disk.intOption("buffer_frames", 0);
+  ReplacementPolicy parsed;
+
+  if (!policy.empty() && !parsePolicy(policy, parsed)) {
+    std::cout << "Política inválida en la configuración: " << policy << "\n";
+    policy.clear();
+  }
+  while (policy.empty()) {
+    std::cout << "Seleccione política de reemplazo (lru / clock / 2q / lru2 / arc): ";
+    if (!(std::cin >> policy))
+      throw std::runtime_error("Falta la política de reemplazo (buffer_policy)");
+    if (parsePolicy(policy, parsed))
       break;
     std::cout << "Política inválida. Intente nuevamente.\n";
+    policy.clear();
   }
 
-  while (true) {
+  while (frame_count <= 0) {
     std::cout << "Ingrese el número de frames del buffer pool: ";
-    std::cin >> frame_count;
+    if (!(std::cin >> frame_count))
+      throw std::runtime_error("Falta el número de frames (buffer_frames)");
     if (frame_count > 0)
       break;
     std::cout << "El número de frames debe ser mayor que 0.\n";
   }
 
-  bufferManager = std::make_unique<BufferManager>(disk_, frame_count, policy);
+  bufferManager =
+      std::make_unique<BufferManager>(disk_, scheduler, wal, frame_count, policy);
+
+  int recovered = wal.recover();
 
   if (!bitmap.load()) {
     std::cout << "Bitmap no encontrado. Inicializando..." << std::endl;
@@ -64,6 +80,28 @@ SGBD::SGBD(Disk &disk_) : disk(disk_), bitmap(disk_), catalog(disk_) {
   if (!relation_to_block.empty()) {
     HashIndex::loadAllFromDisk(disk, relation_to_block);
   }
+
+  for (const auto &[name, rel] : catalog.getAllRelations()) {
+    if (!fsm.load(rel)) {
+      std::cout << "Reconstruyendo mapa de espacio libre de " << name
+                << std::endl;
+      for (int block : rel.blocks)
+        updateFreeSpace(rel, block);
+    }
+  }
+
+  // El WAL rehace las paginas de datos y tambien los metadatos: catalogo,
+  // bitmap e indices hash se registran en cada commit. El mapa de espacio
+  // libre no pasa por el WAL y se recalcula de las paginas ya recuperadas.
+  if (recovered > 0) {
+    for (const auto &[name, rel] : catalog.getAllRelations())
+      for (int block : rel.blocks)
+        updateFreeSpace(rel, block);
+    checkpointer.markDirty();
+  }
+
+  if (disk.intOption("buffer_warm_preload", 0) != 0)
+    bufferManager->preloadWarmSet();
 }
 
 std::vector<std::string> parseCSVLine(const std::string &line) {
@@ -105,11 +143,10 @@ void SGBD::createOrReplaceRelation(const std::string &name, bool is_fixed,
   rel.is_fixed = is_fixed;
   rel.fields = fields;
 
-  int block = bitmap.getFreeBlock();
+  int block = allocator.allocateData(name, -1);
   if (block == -1) {
     throw std::runtime_error("No hay bloques libres para la nueva relación");
   }
-  bitmap.set(block, true);
 
   if (is_fixed) {
     int record_size = calculateRecordSize(fields);
@@ -121,7 +158,7 @@ void SGBD::createOrReplaceRelation(const std::string &name, bool is_fixed,
     int overhead = 4 + 4;
     int bucket_capacity = (block_size - overhead) / entry_size;
 
-    HashIndex::createForRelation(name, disk, bitmap, key_size, bucket_capacity);
+    HashIndex::createForRelation(name, allocator, key_size, bucket_capacity);
     const auto &idx = HashIndex::indices.at(name);
     rel.hash_index_block = idx.getHeaderBlock();
     rel.btree_index_block = -1;
@@ -131,10 +168,11 @@ void SGBD::createOrReplaceRelation(const std::string &name, bool is_fixed,
     rel.btree_index_block = -1;
   }
 
-  rel.blocks.push_back(block);
+  rel.blocks.add(block);
   catalog.addRelation(rel);
-  bitmap.save();
-  catalog.save();
+  Relation &added = catalog.getRelation(name);
+  updateFreeSpace(added, block);
+  checkpointer.markDirty();
 }
 
 void SGBD::printStatus() const {
@@ -162,6 +200,32 @@ static std::string intTo4CharStr(int n) {
   return std::string(buf);
 }
 
+// Registra en el WAL los bytes [offset, offset + length) ya modificados del
+// bloque; la pagina queda sucia con ese LSN al soltar el guard
+void SGBD::logChange(WritePageGuard &page, int offset, int length) {
+  uint64_t lsn = wal.logUpdate(page.blockId(), offset, page.data() + offset, length);
+  page.markDirty(lsn);
+}
+
+// Bytes disponibles para un registro nuevo segun la cabecera del bloque. En
+// los de longitud variable ya descuenta la entrada de la tabla de slots.
+int SGBD::blockFreeSpace(const Relation &rel, int block_idx) {
+  ReadPageGuard page(*bufferManager, block_idx);
+  if (rel.is_fixed) {
+    int record_size = page.number(4, 4);
+    int capacity = page.number(8, 4);
+    int active = page.number(12, 4);
+    return (capacity - active) * record_size;
+  }
+  int num_records = page.number(0, 4);
+  int end_of_freespace = page.number(4, 4);
+  return std::max(0, end_of_freespace - (8 + num_records * 8) - 8);
+}
+
+void SGBD::updateFreeSpace(const Relation &rel, int block_idx) {
+  fsm.update(rel, block_idx, blockFreeSpace(rel, block_idx));
+}
+
 void SGBD::initializeBlockHeader_var(int block_idx) {
   int number_of_records = 0;
   int end_of_freespace = disk.block_size;
@@ -173,9 +237,9 @@ void SGBD::initializeBlockHeader_var(int block_idx) {
 
   std::copy(header_str.begin(), header_str.end(), block_data.begin());
 
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  std::copy(block_data.begin(), block_data.end(), block.begin());
-  bufferManager->markDirty(block_idx);
+  WritePageGuard page(*bufferManager, block_idx);
+  std::copy(block_data.begin(), block_data.end(), page.data());
+  logChange(page, 0, disk.block_size);
 }
 
 void SGBD::initializeBlockHeader_fix(int block_idx, int record_size) {
@@ -191,32 +255,26 @@ void SGBD::initializeBlockHeader_fix(int block_idx, int record_size) {
 
   std::copy(header_str.begin(), header_str.end(), block_data.begin());
 
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  std::copy(block_data.begin(), block_data.end(), block.begin());
-  bufferManager->markDirty(block_idx);
+  WritePageGuard page(*bufferManager, block_idx);
+  std::copy(block_data.begin(), block_data.end(), page.data());
+  logChange(page, 0, disk.block_size);
 }
 
 int SGBD::insertRecord_fix(int block_idx, const std::vector<char> &record) {
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  bufferManager->pin(block_idx);
+  WritePageGuard page(*bufferManager, block_idx);
 
-  int free_list_head = std::stoi(std::string(block.begin(), block.begin() + 4));
-  int record_size =
-      std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-  int capacity = std::stoi(std::string(block.begin() + 8, block.begin() + 12));
-  int active_records =
-      std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+  int free_list_head = page.number(0, 4);
+  int record_size = page.number(4, 4);
+  int capacity = page.number(8, 4);
+  int active_records = page.number(12, 4);
 
   if (record.size() != (size_t)record_size) {
     std::cerr << "Error: tamaño del registro no coincide" << std::endl;
-    bufferManager->unpin(block_idx);
     return -1;
   }
 
-  if (active_records >= capacity && free_list_head == -1) {
-    bufferManager->unpin(block_idx);
+  if (active_records >= capacity && free_list_head == -1)
     return -1;
-  }
 
   int insert_pos;
 
@@ -226,68 +284,52 @@ int SGBD::insertRecord_fix(int block_idx, const std::vector<char> &record) {
     insert_pos = free_list_head;
 
     int reg_offset = HEADER_SIZE_FIX + insert_pos * record_size;
-    std::string next_str(block.begin() + reg_offset,
-                         block.begin() + reg_offset + 4);
-    int next_free = std::stoi(next_str);
-
-    std::string next_free_str = intTo4CharStr(next_free);
-    std::copy(next_free_str.begin(), next_free_str.end(), block.begin());
+    int next_free = page.number(reg_offset, 4);
+    page.put(0, intTo4CharStr(next_free));
   }
 
   active_records++;
-  std::string new_active = intTo4CharStr(active_records);
-  std::copy(new_active.begin(), new_active.end(), block.begin() + 12);
+  page.put(12, intTo4CharStr(active_records));
 
   int final_offset = HEADER_SIZE_FIX + insert_pos * record_size;
-  std::fill(block.begin() + final_offset,
-            block.begin() + final_offset + record_size, 0);
-  std::copy(record.begin(), record.end(), block.begin() + final_offset);
+  char *block = page.data();
+  std::fill(block + final_offset, block + final_offset + record_size, 0);
+  std::copy(record.begin(), record.end(), block + final_offset);
 
-  bufferManager->markDirty(block_idx);
-  bufferManager->unpin(block_idx);
+  logChange(page, 0, HEADER_SIZE_FIX);
+  logChange(page, final_offset, record_size);
   return insert_pos;
 }
 
 bool SGBD::insertRecord_var(int block_idx, const std::vector<char> &record) {
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  bufferManager->pin(block_idx);
+  WritePageGuard page(*bufferManager, block_idx);
 
-  int num_records = std::stoi(std::string(block.begin(), block.begin() + 4));
-  int end_of_freespace =
-      std::stoi(std::string(block.begin() + 4, block.begin() + 8));
+  int num_records = page.number(0, 4);
+  int end_of_freespace = page.number(4, 4);
   int record_size = record.size();
 
   int total_required = 8 + record_size;
   int slot_table_end = 8 + num_records * 8;
 
-  if (end_of_freespace - total_required < slot_table_end) {
-    bufferManager->unpin(block_idx);
+  if (end_of_freespace - total_required < slot_table_end)
     return false;
-  }
 
   int new_offset = end_of_freespace - record_size;
 
-  std::copy(record.begin(), record.end(), block.begin() + new_offset);
-
-  std::string offset_str = intTo4CharStr(new_offset);
-  std::string size_str = intTo4CharStr(record_size);
+  std::copy(record.begin(), record.end(), page.data() + new_offset);
 
-  std::copy(offset_str.begin(), offset_str.end(),
-            block.begin() + slot_table_end);
-  std::copy(size_str.begin(), size_str.end(),
-            block.begin() + slot_table_end + 4);
+  page.put(slot_table_end, intTo4CharStr(new_offset));
+  page.put(slot_table_end + 4, intTo4CharStr(record_size));
 
   num_records++;
   end_of_freespace = new_offset;
 
-  std::string new_num = intTo4CharStr(num_records);
-  std::string new_eof = intTo4CharStr(end_of_freespace);
+  page.put(0, intTo4CharStr(num_records));
+  page.put(4, intTo4CharStr(end_of_freespace));
 
-  std::copy(new_num.begin(), new_num.end(), block.begin());
-  std::copy(new_eof.begin(), new_eof.end(), block.begin() + 4);
-
-  bufferManager->markDirty(block_idx);
-  bufferManager->unpin(block_idx);
+  logChange(page, 0, 8);
+  logChange(page, slot_table_end, 8);
+  logChange(page, new_offset, record_size);
   return true;
 }
 
@@ -298,40 +340,31 @@ bool SGBD::insert_fix(Relation &rel, const std::vector<char> &record) {
     return false;
   }
 
-  // Intentar primero en el último bloque
-  if (!rel.blocks.empty()) {
-    int last_block = rel.blocks.back();
-    int offset = insertRecord_fix(last_block, record);
-    if (offset != -1) {
-      // Actualizar índice hash
-      if (rel.hash_index_block != -1 && !rel.fields.empty()) {
-        std::string key(record.begin(), record.begin() + rel.fields[0].size);
-        HashIndex::indices[rel.name].insert(key, last_block, offset, disk,
-                                            bitmap);
-      }
-      return true;
-    }
-  }
-
-  for (int block_idx : rel.blocks) {
+  // En bloques fijos cualquier slot libre sirve
+  int block_idx;
+  while ((block_idx = fsm.findBlock(rel, 0)) != -1) {
     int offset = insertRecord_fix(block_idx, record);
-    if (offset != -1) {
-      // Actualizar índice hash
-      if (rel.hash_index_block != -1 && !rel.fields.empty()) {
-        std::string key(record.begin(), record.begin() + rel.fields[0].size);
-        HashIndex::indices[rel.name].insert(key, block_idx, offset, disk,
-                                            bitmap);
-      }
-      return true;
+    if (offset == -1) {
+      // Categoria vieja: el bloque se marca lleno para no volver a elegirlo
+      fsm.update(rel, block_idx, 0);
+      continue;
+    }
+    updateFreeSpace(rel, block_idx);
+    // Actualizar índice hash
+    if (rel.hash_index_block != -1 && !rel.fields.empty()) {
+      std::string key(record.begin(), record.begin() + rel.fields[0].size);
+      HashIndex::indices[rel.name].insert(key, block_idx, offset, disk,
+                                          allocator);
     }
+    return true;
   }
 
-  int new_block = bitmap.getFreeBlock();
+  int new_block = allocator.allocateData(
+      rel.name, rel.blocks.empty() ? -1 : rel.blocks.back());
   if (new_block == -1) {
     std::cerr << "No hay bloques libres disponibles para insertar" << std::endl;
     return false;
   }
-  bitmap.set(new_block, true);
   initializeBlockHeader_fix(new_block, record_size);
 
   int offset = insertRecord_fix(new_block, record);
@@ -340,40 +373,30 @@ bool SGBD::insert_fix(Relation &rel, const std::vector<char> &record) {
     return false;
   }
 
-  rel.blocks.push_back(new_block);
-  bitmap.save();
-  catalog.save();
+  rel.blocks.add(new_block);
+  updateFreeSpace(rel, new_block);
+  checkpointer.markDirty();
 
   // Actualizar índice hash
   if (rel.hash_index_block != -1 && !rel.fields.empty()) {
     std::string key(record.begin(), record.begin() + rel.fields[0].size);
-    HashIndex::indices[rel.name].insert(key, new_block, offset, disk, bitmap);
+    HashIndex::indices[rel.name].insert(key, new_block, offset, disk, allocator);
   }
 
   return true;
 }
 
 bool SGBD::insert_var(Relation &rel, const std::vector<char> &record) {
-  if (!rel.blocks.empty()) {
-    int last_block = rel.blocks.back();
-    if (insertRecord_var(last_block, record)) {
-      return true;
-    }
-  }
-
-  for (int block_idx : rel.blocks) {
-    if (insertRecord_var(block_idx, record)) {
-      return true;
-    }
-  }
+  if (insertIntoFreeBlock_var(rel, record) != -1)
+    return true;
 
-  int new_block = bitmap.getFreeBlock();
+  int new_block = allocator.allocateData(
+      rel.name, rel.blocks.empty() ? -1 : rel.blocks.back());
   if (new_block == -1) {
     std::cerr << "No hay bloques libres disponibles para insertar" << std::endl;
     return false;
   }
 
-  bitmap.set(new_block, true);
   initializeBlockHeader_var(new_block);
 
   if (!insertRecord_var(new_block, record)) {
@@ -381,13 +404,30 @@ bool SGBD::insert_var(Relation &rel, const std::vector<char> &record) {
     return false;
   }
 
-  rel.blocks.push_back(new_block);
-  bitmap.save();
-  catalog.save();
+  rel.blocks.add(new_block);
+  updateFreeSpace(rel, new_block);
+  checkpointer.markDirty();
 
   return true;
 }
 
+// Inserta en un bloque existente con espacio segun el mapa de espacio libre.
+// Devuelve el bloque usado o -1 si ninguno tiene lugar.
+int SGBD::insertIntoFreeBlock_var(const Relation &rel,
+                                  const std::vector<char> &record) {
+  int block_idx;
+  while ((block_idx = fsm.findBlock(rel, record.size())) != -1) {
+    if (insertRecord_var(block_idx, record)) {
+      updateFreeSpace(rel, block_idx);
+      return block_idx;
+    }
+    // Categoria vieja: se corrige para que no vuelva a elegirse
+    fsm.update(rel, block_idx,
+               std::min<int>(blockFreeSpace(rel, block_idx), record.size() - 1));
+  }
+  return -1;
+}
+
 bool SGBD::insert(const std::string &relation_name,
                   const std::vector<char> &record) {
   Relation &rel = catalog.getRelation(relation_name);
@@ -433,21 +473,18 @@ void SGBD::printRelation_fix(const std::string &relation_name) {
   std::cout << " |" << std::endl;
   std::cout << separator << std::endl;
 
+  ScanGuard scan(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    ReadPageGuard page = ReadPageGuard::view(*bufferManager, block_idx);
+    const char *block = page.data();
 
-    int free_list_head_header =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
-    int record_size_header =
-        std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-    int active_records_header =
-        std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+    int free_list_head_header = page.number(0, 4);
+    int record_size_header = page.number(4, 4);
+    int active_records_header = page.number(12, 4);
 
     if (record_size_header != record_size) {
       std::cout << "Error: tamaño de registro inconsistente en bloque "
                 << block_idx << std::endl;
-      bufferManager->unpin(block_idx);
       continue;
     }
 
@@ -456,8 +493,7 @@ void SGBD::printRelation_fix(const std::string &relation_name) {
     while (current != -1) {
       deleted_records.insert(current);
       int reg_offset = HEADER_SIZE_FIX + current * record_size;
-      std::string next_str(block.begin() + reg_offset,
-                           block.begin() + reg_offset + 4);
+      std::string next_str(block + reg_offset, block + reg_offset + 4);
       int next_free = std::stoi(next_str);
       current = next_free;
     }
@@ -471,7 +507,7 @@ void SGBD::printRelation_fix(const std::string &relation_name) {
         int field_offset = 0;
         for (size_t j = 0; j < rel.fields.size(); ++j) {
           const auto &f = rel.fields[j];
-          std::string field_data(block.data() + offset + field_offset, f.size);
+          std::string field_data(block + offset + field_offset, f.size);
           std::cout << " " << std::left << std::setw(column_widths[j])
                     << field_data;
           field_offset += f.size;
@@ -480,8 +516,8 @@ void SGBD::printRelation_fix(const std::string &relation_name) {
       }
       offset += record_size;
     }
-    bufferManager->unpin(block_idx);
   }
+  scan.release();
 
   std::cout << separator << std::endl;
 }
@@ -505,21 +541,21 @@ void SGBD::printRelation_var(const std::string &relation_name) {
   }
 
   // PRIMERA PASADA: Calcular tamaños máximos de cada columna
+  ScanGuard first_pass(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
-    int num_records = std::stoi(std::string(block.begin(), block.begin() + 4));
+    ReadPageGuard page(*bufferManager, block_idx);
+    const char *block = page.data();
+    int num_records = page.number(0, 4);
     int metadata_start = HEADER_SIZE_VAR;
 
     for (int i = 0; i < num_records; ++i) {
       int entry_offset = metadata_start + i * 8;
-      int record_offset = std::stoi(std::string(
-          block.begin() + entry_offset, block.begin() + entry_offset + 4));
+      int record_offset = page.number(entry_offset, 4);
       if (record_offset == -1)
         continue;
 
-      std::string reg_header(block.begin() + record_offset,
-                             block.begin() + record_offset +
+      std::string reg_header(block + record_offset,
+                             block + record_offset +
                                  rel.fields.size() * 6);
 
       for (size_t j = 0; j < rel.fields.size(); ++j) {
@@ -532,14 +568,14 @@ void SGBD::printRelation_var(const std::string &relation_name) {
 
         int absolute_offset =
             record_offset + rel.fields.size() * 6 + field_rel_offset;
-        std::string field_data(block.begin() + absolute_offset,
-                               block.begin() + absolute_offset + field_length);
+        std::string field_data(block + absolute_offset,
+                               block + absolute_offset + field_length);
 
         column_widths[j] = std::max(column_widths[j], (int)field_data.size());
       }
     }
-    bufferManager->unpin(block_idx);
   }
+  first_pass.release();
 
   // Imprimir encabezado
   int total_width = 3;
@@ -558,22 +594,22 @@ void SGBD::printRelation_var(const std::string &relation_name) {
   std::cout << separator << std::endl;
 
   // SEGUNDA PASADA: Imprimir datos
+  ScanGuard second_pass(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
-    int num_records = std::stoi(std::string(block.begin(), block.begin() + 4));
+    ReadPageGuard page(*bufferManager, block_idx);
+    const char *block = page.data();
+    int num_records = page.number(0, 4);
     int metadata_start = HEADER_SIZE_VAR;
 
     for (int i = 0; i < num_records; ++i) {
       int entry_offset = metadata_start + i * 8;
-      int record_offset = std::stoi(std::string(
-          block.begin() + entry_offset, block.begin() + entry_offset + 4));
+      int record_offset = page.number(entry_offset, 4);
       if (record_offset == -1)
         continue;
 
       int record_header_size = rel.fields.size() * 6;
-      std::string reg_header(block.begin() + record_offset,
-                             block.begin() + record_offset +
+      std::string reg_header(block + record_offset,
+                             block + record_offset +
                                  record_header_size);
 
       std::vector<std::string> campos;
@@ -587,8 +623,8 @@ void SGBD::printRelation_var(const std::string &relation_name) {
 
         int absolute_offset =
             record_offset + record_header_size + field_rel_offset;
-        std::string field_data(block.begin() + absolute_offset,
-                               block.begin() + absolute_offset + field_length);
+        std::string field_data(block + absolute_offset,
+                               block + absolute_offset + field_length);
         campos.push_back(field_data);
       }
 
@@ -599,8 +635,8 @@ void SGBD::printRelation_var(const std::string &relation_name) {
       }
       std::cout << " |" << std::endl;
     }
-    bufferManager->unpin(block_idx);
   }
+  second_pass.release();
 
   std::cout << separator << std::endl;
 }
@@ -774,10 +810,12 @@ void SGBD::createOrReplaceRelationFromCSV_var(const std::string &relation_name,
 bool SGBD::deleteRelation(const std::string &name) {
   if (catalog.hasRelation(name)) {
     const Relation &oldRel = catalog.getRelation(name);
+    std::vector<int> freed;
 
     // Liberar bloques de datos de la relación
     for (int block : oldRel.blocks) {
       bitmap.set(block, false);
+      freed.push_back(block);
     }
 
     // Si la relación tiene índice hash, liberar sus bloques
@@ -787,19 +825,32 @@ bool SGBD::deleteRelation(const std::string &name) {
         HashIndex &idx = it->second;
         // Liberar bloque de cabecera
         bitmap.set(idx.header_block, false);
+        freed.push_back(idx.header_block);
         // Liberar bloques de buckets (puede haber repetidos, pero set es
         // idempotente)
         for (int block : idx.directory) {
           bitmap.set(block, false);
+          freed.push_back(block);
         }
         // Eliminar el índice de memoria
         HashIndex::indices.erase(it);
       }
     }
 
-    bitmap.save();
+    for (int block : fsm.storageBlocks(name)) {
+      bitmap.set(block, false);
+      freed.push_back(block);
+    }
+    fsm.drop(name);
+
+    // Sus frames se descartan sin escribirlos: el bloque puede volver a
+    // asignarse para catalogo o indices, que no pasan por el pool
+    for (int block : freed)
+      bufferManager->discardBlock(block);
+
+    allocator.releaseRelation(name);
     catalog.removeRelation(name);
-    catalog.save();
+    checkpointer.markDirty();
     return true;
   }
   std::cout << "Relacion a borrar no encontrada: " << name << std::endl;
@@ -822,10 +873,10 @@ void SGBD::printRelationSchema(const std::string &relation_name) {
               << ")\n";
   }
   std::cout << "Bloques asignados: ";
-  for (size_t i = 0; i < rel.blocks.size(); ++i) {
-    std::cout << rel.blocks[i];
-    if (i + 1 < rel.blocks.size())
-      std::cout << ", ";
+  const char *sep = "";
+  for (int block : rel.blocks) {
+    std::cout << sep << block;
+    sep = ", ";
   }
   std::cout << std::endl;
 }
@@ -944,13 +995,12 @@ void SGBD::selectWhere_fix(const std::string &relation_name,
 
     auto refs = HashIndex::indices[input_rel.name].search(value_formateado);
     for (auto [block_idx, offset] : refs) {
-      std::vector<char> &block = bufferManager->getBlock(block_idx);
-      bufferManager->pin(block_idx);
+      ReadPageGuard page = ReadPageGuard::view(*bufferManager, block_idx);
+      const char *block = page.data();
       int reg_offset = HEADER_SIZE_FIX + offset * record_size;
-      std::vector<char> reg(block.begin() + reg_offset,
-                            block.begin() + reg_offset + record_size);
+      std::vector<char> reg(block + reg_offset,
+                            block + reg_offset + record_size);
       insert(output_name, reg);
-      bufferManager->unpin(block_idx);
     }
     printRelation(output_name);
     if (output_name == "temp_result") {
@@ -961,21 +1011,18 @@ void SGBD::selectWhere_fix(const std::string &relation_name,
 
   const std::string &field_type = input_rel.fields[field_idx].type;
 
+  ScanGuard scan(*bufferManager, input_rel.blocks);
   for (int block_idx : input_rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    ReadPageGuard page = ReadPageGuard::view(*bufferManager, block_idx);
+    const char *block = page.data();
 
-    int free_list_head =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
-    int record_size_header =
-        std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-    int active_records =
-        std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+    int free_list_head = page.number(0, 4);
+    int record_size_header = page.number(4, 4);
+    int active_records = page.number(12, 4);
 
     if (record_size_header != record_size) {
       std::cout << "Record size no coincide, saltando bloque ... ERROR critico"
                 << std::endl;
-      bufferManager->unpin(block_idx);
       continue;
     }
 
@@ -984,8 +1031,7 @@ void SGBD::selectWhere_fix(const std::string &relation_name,
     while (current != -1) {
       deleted.insert(current);
       int reg_offset = HEADER_SIZE_FIX + current * record_size;
-      int next = std::stoi(std::string(block.begin() + reg_offset,
-                                       block.begin() + reg_offset + 4));
+      int next = page.number(reg_offset, 4);
       current = next;
     }
 
@@ -998,8 +1044,8 @@ void SGBD::selectWhere_fix(const std::string &relation_name,
         continue;
       }
 
-      std::string field_val(block.begin() + pos + offset,
-                            block.begin() + pos + offset +
+      std::string field_val(block + pos + offset,
+                            block + pos + offset +
                                 input_rel.fields[field_idx].size);
       field_val = trim(field_val);
 
@@ -1033,15 +1079,14 @@ void SGBD::selectWhere_fix(const std::string &relation_name,
       }
 
       if (match) {
-        std::vector<char> reg(block.begin() + pos,
-                              block.begin() + pos + record_size);
+        std::vector<char> reg(block + pos, block + pos + record_size);
         insert(output_name, reg);
       }
 
       pos += record_size;
     }
-    bufferManager->unpin(block_idx);
   }
+  scan.release();
 
   printRelation(output_name);
 
@@ -1072,20 +1117,18 @@ void SGBD::selectWhere_var(const std::string &relation_name,
   createOrReplaceRelation(output_name, false, input_rel.fields);
   const std::string &field_type = input_rel.fields[field_idx].type;
 
+  ScanGuard scan(*bufferManager, input_rel.blocks);
   for (int block_idx : input_rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    ReadPageGuard page(*bufferManager, block_idx);
+    const char *block = page.data();
 
-    int total_records =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
+    int total_records = page.number(0, 4);
 
     for (int i = 0; i < total_records; ++i) {
       int entry_offset = 8 + i * 8;
 
-      int reg_offset = std::stoi(std::string(block.begin() + entry_offset,
-                                             block.begin() + entry_offset + 4));
-      int reg_size = std::stoi(std::string(block.begin() + entry_offset + 4,
-                                           block.begin() + entry_offset + 8));
+      int reg_offset = page.number(entry_offset, 4);
+      int reg_size = page.number(entry_offset + 4, 4);
 
       if (reg_offset == -1)
         continue;
@@ -1096,10 +1139,8 @@ void SGBD::selectWhere_var(const std::string &relation_name,
       for (size_t j = 0; j < input_rel.fields.size(); ++j) {
         int local = reg_start + j * 6;
 
-        int off = std::stoi(
-            std::string(block.begin() + local, block.begin() + local + 3));
-        int len = std::stoi(
-            std::string(block.begin() + local + 3, block.begin() + local + 6));
+        int off = page.number(local, 3);
+        int len = page.number(local + 3, 3);
         campo_offsets.emplace_back(off, len);
       }
 
@@ -1108,8 +1149,8 @@ void SGBD::selectWhere_var(const std::string &relation_name,
       int field_len = campo_offsets[field_idx].second;
       int field_abs_offset = reg_start + header_size + field_rel_offset;
 
-      std::string field_val(block.begin() + field_abs_offset,
-                            block.begin() + field_abs_offset + field_len);
+      std::string field_val(block + field_abs_offset,
+                            block + field_abs_offset + field_len);
       field_val = trim(field_val);
 
       bool match = false;
@@ -1139,13 +1180,13 @@ void SGBD::selectWhere_var(const std::string &relation_name,
       }
 
       if (match) {
-        std::vector<char> registro(block.begin() + reg_offset,
-                                   block.begin() + reg_offset + reg_size);
+        std::vector<char> registro(block + reg_offset,
+                                   block + reg_offset + reg_size);
         insert(output_name, registro);
       }
     }
-    bufferManager->unpin(block_idx);
   }
+  scan.release();
 
   printRelation(output_name);
 
@@ -1170,23 +1211,19 @@ void SGBD::printRelBlockInfo(const std::string &relation_name) {
   const Relation &rel = catalog.getRelation(relation_name);
   std::cout << "\nBloques de la relación '" << rel.name << "':\n";
 
+  ScanGuard scan(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    ReadPageGuard page(*bufferManager, block_idx);
 
     int used_bytes = 0;
 
     if (rel.is_fixed) {
-      int record_size =
-          std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-      int active_records =
-          std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+      int record_size = page.number(4, 4);
+      int active_records = page.number(12, 4);
       used_bytes = HEADER_SIZE_FIX + record_size * active_records;
     } else {
-      int total_records =
-          std::stoi(std::string(block.begin(), block.begin() + 4));
-      int free_space_offset =
-          std::stoi(std::string(block.begin() + 4, block.begin() + 8));
+      int total_records = page.number(0, 4);
+      int free_space_offset = page.number(4, 4);
       int data_bytes = disk.block_size - free_space_offset;
       used_bytes = HEADER_SIZE_VAR + 8 * total_records + data_bytes;
     }
@@ -1195,8 +1232,8 @@ void SGBD::printRelBlockInfo(const std::string &relation_name) {
               << " | Posición física: " << disk.getBlockPosition(block_idx)
               << " | Bytes ocupados: " << used_bytes << " / " << disk.block_size
               << '\n';
-    bufferManager->unpin(block_idx);
   }
+  scan.release();
 
   std::cout << std::endl;
 }
@@ -1266,20 +1303,19 @@ void SGBD::insertFromShell_var(const std::string &relation_name,
   for (const std::string &field : trimmed_values)
     record.insert(record.end(), field.begin(), field.end());
 
-  for (int block_idx : rel.blocks) {
-    if (insertRecord_var(block_idx, record)) {
-      disk.printBlockPosition(block_idx);
-      return;
-    }
+  int block_idx = insertIntoFreeBlock_var(rel, record);
+  if (block_idx != -1) {
+    disk.printBlockPosition(block_idx);
+    return;
   }
 
-  int new_block = bitmap.getFreeBlock();
+  int new_block = allocator.allocateData(
+      rel.name, rel.blocks.empty() ? -1 : rel.blocks.back());
   if (new_block == -1) {
     std::cerr << "Error: no hay bloques libres disponibles." << std::endl;
     return;
   }
 
-  bitmap.set(new_block, true);
   initializeBlockHeader_var(new_block);
 
   if (!insertRecord_var(new_block, record)) {
@@ -1288,9 +1324,9 @@ void SGBD::insertFromShell_var(const std::string &relation_name,
     return;
   }
 
-  rel.blocks.push_back(new_block);
-  bitmap.save();
-  catalog.save();
+  rel.blocks.add(new_block);
+  updateFreeSpace(rel, new_block);
+  checkpointer.markDirty();
 
   disk.printBlockPosition(new_block);
 }
@@ -1309,7 +1345,8 @@ void SGBD::printDiskCapacityInfo() {
   int total_blocks = bitmap.size();
   int block_size = disk.block_size;
 
-  int reserved_blocks = 2; // Bloques 0 y 1 (bitmap y catálogo)
+  // Bitmap (bloque 0 y siguientes al 1) y catálogo (bloque 1)
+  int reserved_blocks = 1 + bitmap.storageBlocks();
   int free_blocks = 0;
   int used_blocks = 0;
   int data_blocks = 0;
@@ -1331,31 +1368,27 @@ void SGBD::printDiskCapacityInfo() {
   for (const auto &pair : catalog.getAllRelations()) {
     const Relation &rel = pair.second;
 
+    ScanGuard scan(*bufferManager, rel.blocks);
     for (int block_idx : rel.blocks) {
       data_blocks++;
 
-      std::vector<char> &block = bufferManager->getBlock(block_idx);
-      bufferManager->pin(block_idx);
+      ReadPageGuard page(*bufferManager, block_idx);
 
       if (rel.is_fixed) {
-        int record_size =
-            std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-        int active_records =
-            std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+        int record_size = page.number(4, 4);
+        int active_records = page.number(12, 4);
 
         bytes_used_in_data += record_size * active_records + HEADER_SIZE_FIX;
       } else {
-        int total_records =
-            std::stoi(std::string(block.begin(), block.begin() + 4));
-        int free_space_offset =
-            std::stoi(std::string(block.begin() + 4, block.begin() + 8));
+        int total_records = page.number(0, 4);
+        int free_space_offset = page.number(4, 4);
         int used_data_bytes = block_size - free_space_offset;
 
         bytes_used_in_data +=
             used_data_bytes + HEADER_SIZE_VAR + 8 * total_records;
       }
-      bufferManager->unpin(block_idx);
     }
+    scan.release();
   }
 
   int total_capacity = total_blocks * block_size;
@@ -1538,8 +1571,8 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
 
     auto refs = HashIndex::indices[rel.name].search(value_formateado);
     for (auto [block_idx, offset_logico] : refs) {
-      std::vector<char> &block = bufferManager->getBlock(block_idx);
-      bufferManager->pin(block_idx);
+      WritePageGuard page(*bufferManager, block_idx);
+      char *block = page.data();
 
       int reg_offset = HEADER_SIZE_FIX + offset_logico * record_size;
 
@@ -1548,45 +1581,42 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
                                           offset_logico);
 
       // Eliminar físicamente el registro (igual que en el ciclo tradicional)
-      int free_list_head =
-          std::stoi(std::string(block.begin(), block.begin() + 4));
+      int free_list_head = page.number(0, 4);
       std::string next_str = intTo4CharStr(free_list_head);
-      std::copy(next_str.begin(), next_str.end(), block.begin() + reg_offset);
+      std::copy(next_str.begin(), next_str.end(), block + reg_offset);
 
       free_list_head = offset_logico;
       std::string head_str = intTo4CharStr(free_list_head);
-      std::copy(head_str.begin(), head_str.end(), block.begin());
+      std::copy(head_str.begin(), head_str.end(), block);
 
-      int active_records =
-          std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+      int active_records = page.number(12, 4);
       active_records--;
       std::string new_active_str = intTo4CharStr(active_records);
       std::copy(new_active_str.begin(), new_active_str.end(),
-                block.begin() + 12);
+                block + 12);
 
-      bufferManager->markDirty(block_idx);
-      bufferManager->unpin(block_idx);
+      logChange(page, 0, HEADER_SIZE_FIX);
+      logChange(page, reg_offset, 4);
+      page.release();
+      updateFreeSpace(rel, block_idx);
       std::cout << "Ubicacion del registro eliminado" << std::endl;
       disk.printBlockPosition(block_idx);
     }
     return;
   }
 
+  ScanGuard scan(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    WritePageGuard page(*bufferManager, block_idx);
+    char *block = page.data();
 
-    int free_list_head =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
-    int record_size_header =
-        std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-    int active_records =
-        std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+    int free_list_head = page.number(0, 4);
+    int record_size_header = page.number(4, 4);
+    int active_records = page.number(12, 4);
 
     if (record_size_header != record_size) {
       std::cout << "Record size no coincide, saltando bloque... (ERROR crítico)"
                 << std::endl;
-      bufferManager->unpin(block_idx);
       continue;
     }
 
@@ -1595,8 +1625,7 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
     while (current != -1) {
       deleted.insert(current);
       int reg_offset = HEADER_SIZE_FIX + current * record_size;
-      int next = std::stoi(std::string(block.begin() + reg_offset,
-                                       block.begin() + reg_offset + 4));
+      int next = page.number(reg_offset, 4);
       current = next;
     }
 
@@ -1610,8 +1639,8 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
         continue;
       }
 
-      std::string field_val(block.begin() + pos + offset,
-                            block.begin() + pos + offset +
+      std::string field_val(block + pos + offset,
+                            block + pos + offset +
                                 rel.fields[field_idx].size);
       field_val = trim(field_val);
 
@@ -1646,25 +1675,26 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
 
         // Eliminar del índice hash si corresponde
         if (rel.hash_index_block != -1 && !rel.fields.empty()) {
-          std::string key(block.begin() + pos,
-                          block.begin() + pos + rel.fields[0].size);
+          std::string key(block + pos,
+                          block + pos + rel.fields[0].size);
           HashIndex::indices[rel.name].remove(key, block_idx, i);
         }
 
         // escribir el antiguo free_list_head como "next" del nuevo eliminado
         std::string next_str = intTo4CharStr(free_list_head);
-        std::copy(next_str.begin(), next_str.end(), block.begin() + reg_offset);
+        std::copy(next_str.begin(), next_str.end(), block + reg_offset);
+        logChange(page, reg_offset, 4);
 
         // actualizar el free_list_head
         free_list_head = i;
         std::string head_str = intTo4CharStr(free_list_head);
-        std::copy(head_str.begin(), head_str.end(), block.begin());
+        std::copy(head_str.begin(), head_str.end(), block);
 
         // actualizar active_records
         active_records--;
         std::string new_active_str = intTo4CharStr(active_records);
         std::copy(new_active_str.begin(), new_active_str.end(),
-                  block.begin() + 12);
+                  block + 12);
 
         modified = true;
       }
@@ -1673,11 +1703,12 @@ void SGBD::deleteWhere_fix(const std::string &relation_name,
     }
 
     if (modified) {
-      bufferManager->markDirty(block_idx);
+      logChange(page, 0, HEADER_SIZE_FIX);
+      page.release();
+      updateFreeSpace(rel, block_idx);
       std::cout << "Ubicacion del registro eliminado" << std::endl;
       disk.printBlockPosition(block_idx);
     }
-    bufferManager->unpin(block_idx);
   }
 }
 
@@ -1701,19 +1732,18 @@ void SGBD::deleteWhere_var(const std::string &relation_name,
 
   const std::string &field_type = rel.fields[field_idx].type;
 
+  ScanGuard scan(*bufferManager, rel.blocks);
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    WritePageGuard page(*bufferManager, block_idx);
+    char *block = page.data();
 
-    int total_records =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
+    int total_records = page.number(0, 4);
     bool modified = false;
 
     for (int i = 0; i < total_records; ++i) {
       int entry_offset = 8 + i * 8;
 
-      int reg_offset = std::stoi(std::string(block.begin() + entry_offset,
-                                             block.begin() + entry_offset + 4));
+      int reg_offset = page.number(entry_offset, 4);
 
       if (reg_offset == -1)
         continue;
@@ -1723,10 +1753,8 @@ void SGBD::deleteWhere_var(const std::string &relation_name,
       std::vector<std::pair<int, int>> campo_offsets;
       for (size_t j = 0; j < rel.fields.size(); ++j) {
         int local = reg_start + j * 6;
-        int off = std::stoi(
-            std::string(block.begin() + local, block.begin() + local + 3));
-        int len = std::stoi(
-            std::string(block.begin() + local + 3, block.begin() + local + 6));
+        int off = page.number(local, 3);
+        int len = page.number(local + 3, 3);
         campo_offsets.emplace_back(off, len);
       }
 
@@ -1735,8 +1763,8 @@ void SGBD::deleteWhere_var(const std::string &relation_name,
       int field_len = campo_offsets[field_idx].second;
       int field_abs_offset = reg_start + header_size + field_rel_offset;
 
-      std::string field_val(block.begin() + field_abs_offset,
-                            block.begin() + field_abs_offset + field_len);
+      std::string field_val(block + field_abs_offset,
+                            block + field_abs_offset + field_len);
       field_val = trim(field_val);
 
       bool match = false;
@@ -1768,16 +1796,17 @@ void SGBD::deleteWhere_var(const std::string &relation_name,
       if (match) {
         std::string minus_one = intTo4CharStr(-1);
         std::copy(minus_one.begin(), minus_one.end(),
-                  block.begin() + entry_offset);
+                  block + entry_offset);
+        logChange(page, entry_offset, 4);
         modified = true;
       }
     }
 
     if (modified) {
-      bufferManager->markDirty(block_idx);
-      compactBlock_var(block_idx);
+      compactBlock_var(page);
+      page.release();
+      updateFreeSpace(rel, block_idx);
     }
-    bufferManager->unpin(block_idx);
   }
 }
 
@@ -1791,13 +1820,13 @@ void SGBD::deleteWhere(const std::string &relation_name,
   } else {
     deleteWhere_var(relation_name, field_name, value, op);
   }
+  checkpointer.markDirty();
 }
 
-void SGBD::compactBlock_var(int block_idx) {
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  bufferManager->pin(block_idx);
+void SGBD::compactBlock_var(WritePageGuard &page) {
+  char *block = page.data();
 
-  int total_records = std::stoi(std::string(block.begin(), block.begin() + 4));
+  int total_records = page.number(0, 4);
 
   std::vector<std::vector<char>> valid_records;
   std::vector<int> valid_sizes;
@@ -1805,24 +1834,22 @@ void SGBD::compactBlock_var(int block_idx) {
   for (int i = 0; i < total_records; ++i) {
     int entry_offset = 8 + i * 8;
 
-    int reg_offset = std::stoi(std::string(block.begin() + entry_offset,
-                                           block.begin() + entry_offset + 4));
-    int reg_size = std::stoi(std::string(block.begin() + entry_offset + 4,
-                                         block.begin() + entry_offset + 8));
+    int reg_offset = page.number(entry_offset, 4);
+    int reg_size = page.number(entry_offset + 4, 4);
 
     if (reg_offset == -1)
       continue;
 
-    std::vector<char> registro(block.begin() + reg_offset,
-                               block.begin() + reg_offset + reg_size);
+    std::vector<char> registro(block + reg_offset,
+                               block + reg_offset + reg_size);
     valid_records.push_back(registro);
     valid_sizes.push_back(reg_size);
   }
 
-  std::fill(block.begin(), block.end(), 0);
+  std::fill(block, block + page.size(), 0);
 
   int new_num_records = valid_records.size();
-  int eof = block.size();
+  int eof = page.size();
   int slot_ptr = 8;
 
   for (size_t i = 0; i < valid_records.size(); ++i) {
@@ -1830,13 +1857,13 @@ void SGBD::compactBlock_var(int block_idx) {
     int size = valid_sizes[i];
     int new_offset = eof - size;
 
-    std::copy(reg.begin(), reg.end(), block.begin() + new_offset);
+    std::copy(reg.begin(), reg.end(), block + new_offset);
 
     std::string offset_str = intTo4CharStr(new_offset);
     std::string size_str = intTo4CharStr(size);
 
-    std::copy(offset_str.begin(), offset_str.end(), block.begin() + slot_ptr);
-    std::copy(size_str.begin(), size_str.end(), block.begin() + slot_ptr + 4);
+    std::copy(offset_str.begin(), offset_str.end(), block + slot_ptr);
+    std::copy(size_str.begin(), size_str.end(), block + slot_ptr + 4);
 
     slot_ptr += 8;
     eof = new_offset;
@@ -1845,29 +1872,31 @@ void SGBD::compactBlock_var(int block_idx) {
   std::string num_str = intTo4CharStr(new_num_records);
   std::string eof_str = intTo4CharStr(eof);
 
-  std::copy(num_str.begin(), num_str.end(), block.begin());
-  std::copy(eof_str.begin(), eof_str.end(), block.begin() + 4);
+  std::copy(num_str.begin(), num_str.end(), block);
+  std::copy(eof_str.begin(), eof_str.end(), block + 4);
 
-  bufferManager->markDirty(block_idx);
-  bufferManager->unpin(block_idx);
+  logChange(page, 0, disk.block_size);
 }
 
 void SGBD::printBlock(int block_idx) {
-  std::vector<char> &block = bufferManager->getBlock(block_idx);
-  bufferManager->pin(block_idx);
+  if (block_idx < 0 || block_idx >= disk.totalBlocks()) {
+    std::cerr << "Error: bloque fuera de rango: " << block_idx << std::endl;
+    return;
+  }
+  ReadPageGuard page(*bufferManager, block_idx);
+  const char *block = page.data();
 
   std::cout << "Contenido del bloque " << block_idx << "\n";
 
   const int bytes_per_line = 64;
-  for (size_t i = 0; i < block.size(); i += bytes_per_line) {
-    for (size_t j = 0; j < bytes_per_line && i + j < block.size(); ++j) {
+  for (int i = 0; i < page.size(); i += bytes_per_line) {
+    for (int j = 0; j < bytes_per_line && i + j < page.size(); ++j) {
       char c = block[i + j];
       std::cout << (std::isprint(static_cast<unsigned char>(c)) ? c : '.');
     }
     std::cout << '\n';
   }
 
-  bufferManager->unpin(block_idx);
 }
 
 void SGBD::modifyFromShell_fix(const std::string &relation_name,
@@ -1909,8 +1938,8 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
     auto refs = HashIndex::indices[rel.name].search(value_formateado);
     bool found = false;
     for (auto [block_idx, offset_logico] : refs) {
-      std::vector<char> &block = bufferManager->getBlock(block_idx);
-      bufferManager->pin(block_idx);
+      WritePageGuard page(*bufferManager, block_idx);
+      char *block = page.data();
 
       int reg_offset = HEADER_SIZE_FIX + offset_logico * record_size;
 
@@ -1924,7 +1953,6 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
           std::cerr << "Error: valor '" << val
                     << "' excede el tamaño del campo '" << rel.fields[j].name
                     << "'." << std::endl;
-          bufferManager->unpin(block_idx);
           return;
         }
 
@@ -1934,9 +1962,9 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
 
       // Actualizar el registro en el bloque
       std::copy(new_record.begin(), new_record.end(),
-                block.begin() + reg_offset);
-      bufferManager->markDirty(block_idx);
-      bufferManager->unpin(block_idx);
+                block + reg_offset);
+      logChange(page, reg_offset, record_size);
+      page.release();
 
       // Actualizar el índice hash si la clave cambió
       std::string old_key = value_formateado;
@@ -1945,7 +1973,7 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
       if (old_key != new_key) {
         HashIndex::indices[rel.name].remove(old_key, block_idx, offset_logico);
         HashIndex::indices[rel.name].insert(new_key, block_idx, offset_logico,
-                                            disk, bitmap);
+                                            disk, allocator);
       }
 
       found = true;
@@ -1960,19 +1988,15 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
   }
 
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    WritePageGuard page(*bufferManager, block_idx);
+    char *block = page.data();
 
-    int free_list_head =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
-    int record_size_header =
-        std::stoi(std::string(block.begin() + 4, block.begin() + 8));
-    int active_records =
-        std::stoi(std::string(block.begin() + 12, block.begin() + 16));
+    int free_list_head = page.number(0, 4);
+    int record_size_header = page.number(4, 4);
+    int active_records = page.number(12, 4);
 
     if (record_size != record_size_header) {
       std::cerr << "Record size no coincide, saltando bloque." << std::endl;
-      bufferManager->unpin(block_idx);
       continue;
     }
 
@@ -1981,8 +2005,7 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
     while (current != -1) {
       deleted.insert(current);
       int reg_offset = HEADER_SIZE_FIX + current * record_size;
-      int next = std::stoi(std::string(block.begin() + reg_offset,
-                                       block.begin() + reg_offset + 4));
+      int next = page.number(reg_offset, 4);
       current = next;
     }
 
@@ -1995,8 +2018,8 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
         continue;
       }
 
-      std::string field_val(block.begin() + pos + offset,
-                            block.begin() + pos + offset +
+      std::string field_val(block + pos + offset,
+                            block + pos + offset +
                                 rel.fields[field_idx].size);
       field_val = trim(field_val);
 
@@ -2010,7 +2033,6 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
             std::cerr << "Error: valor '" << val
                       << "' excede el tamaño del campo '" << rel.fields[j].name
                       << "'." << std::endl;
-            bufferManager->unpin(block_idx);
             return;
           }
 
@@ -2021,20 +2043,20 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
         // Si la relación tiene índice hash y la clave primaria cambia,
         // actualiza el índice
         if (rel.hash_index_block != -1 && !rel.fields.empty()) {
-          std::string old_key(block.begin() + pos,
-                              block.begin() + pos + rel.fields[0].size);
+          std::string old_key(block + pos,
+                              block + pos + rel.fields[0].size);
           std::string new_key(new_record.begin(),
                               new_record.begin() + rel.fields[0].size);
           if (old_key != new_key) {
             HashIndex::indices[rel.name].remove(old_key, block_idx, i);
             HashIndex::indices[rel.name].insert(new_key, block_idx, i, disk,
-                                                bitmap);
+                                                allocator);
           }
         }
 
-        std::copy(new_record.begin(), new_record.end(), block.begin() + pos);
-        bufferManager->markDirty(block_idx);
-        bufferManager->unpin(block_idx);
+        std::copy(new_record.begin(), new_record.end(), block + pos);
+        logChange(page, pos, record_size);
+        page.release();
 
         std::cout << "Registro modificado exitosamente." << std::endl;
         return;
@@ -2043,7 +2065,6 @@ void SGBD::modifyFromShell_fix(const std::string &relation_name,
       pos += record_size;
     }
 
-    bufferManager->unpin(block_idx);
   }
 
   std::cout << "Registro no encontrado con valor '" << value << "' en campo '"
@@ -2076,17 +2097,15 @@ void SGBD::modifyFromShell_var(const std::string &relation_name,
   }
 
   for (int block_idx : rel.blocks) {
-    std::vector<char> &block = bufferManager->getBlock(block_idx);
-    bufferManager->pin(block_idx);
+    WritePageGuard page(*bufferManager, block_idx);
+    char *block = page.data();
 
-    int total_records =
-        std::stoi(std::string(block.begin(), block.begin() + 4));
+    int total_records = page.number(0, 4);
 
     for (int i = 0; i < total_records; ++i) {
       int entry_offset = 8 + i * 8;
 
-      int reg_offset = std::stoi(std::string(block.begin() + entry_offset,
-                                             block.begin() + entry_offset + 4));
+      int reg_offset = page.number(entry_offset, 4);
 
       if (reg_offset == -1)
         continue;
@@ -2096,10 +2115,8 @@ void SGBD::modifyFromShell_var(const std::string &relation_name,
       std::vector<std::pair<int, int>> campo_offsets;
       for (size_t j = 0; j < rel.fields.size(); ++j) {
         int local = reg_start + j * 6;
-        int off = std::stoi(
-            std::string(block.begin() + local, block.begin() + local + 3));
-        int len = std::stoi(
-            std::string(block.begin() + local + 3, block.begin() + local + 6));
+        int off = page.number(local, 3);
+        int len = page.number(local + 3, 3);
         campo_offsets.emplace_back(off, len);
       }
 
@@ -2108,16 +2125,18 @@ void SGBD::modifyFromShell_var(const std::string &relation_name,
       int field_len = campo_offsets[field_idx].second;
       int field_abs_offset = reg_start + header_size + field_rel_offset;
 
-      std::string field_val(block.begin() + field_abs_offset,
-                            block.begin() + field_abs_offset + field_len);
+      std::string field_val(block + field_abs_offset,
+                            block + field_abs_offset + field_len);
       field_val = trim(field_val);
 
       if (field_val == value) {
         std::string neg1 = "-001";
-        std::copy(neg1.begin(), neg1.end(), block.begin() + entry_offset);
-        bufferManager->markDirty(block_idx);
+        std::copy(neg1.begin(), neg1.end(), block + entry_offset);
+        logChange(page, entry_offset, 4);
 
-        compactBlock_var(block_idx);
+        compactBlock_var(page);
+        page.release();
+        updateFreeSpace(rel, block_idx);
 
         std::vector<std::string> trimmed_fields;
         for (const auto &v : new_values)
@@ -2147,13 +2166,11 @@ void SGBD::modifyFromShell_var(const std::string &relation_name,
                     << std::endl;
         }
 
-        bufferManager->unpin(block_idx);
         std::cout << "Registro modificado exitosamente." << std::endl;
         return;
       }
     }
 
-    bufferManager->unpin(block_idx);
   }
 
   std::cout << "Registro no encontrado con valor '" << value << "' en campo '"
@@ -1,10 +1,16 @@
 #pragma once
 
+#include "allocator.h"
 #include "bitmap.h"
 #include "buffermanager.h"
 #include "catalog.h"
+#include "checkpoint.h"
 #include "disk.h"
+#include "fsm.h"
 #include "hash_index.h"
+#include "pageguard.h"
+#include "scheduler.h"
+#include "wal.h"
 #include <iostream>
 #include <memory>
 
@@ -15,8 +21,13 @@ public:
 
   Disk &disk;
   Bitmap bitmap;
+  Allocator allocator;
+  FreeSpaceMap fsm;
   Catalog catalog;
+  IOScheduler scheduler;
+  WriteAheadLog wal;
   std::unique_ptr<BufferManager> bufferManager;
+  CheckpointManager checkpointer;
 
   SGBD(Disk &disk_);
 
@@ -27,6 +38,11 @@ public:
   bool deleteRelation(const std::string &name);
   void printRelBlockInfo(const std::string &relation_name);
 
+  void logChange(WritePageGuard &page, int offset, int length);
+
+  int blockFreeSpace(const Relation &rel, int block_idx);
+  void updateFreeSpace(const Relation &rel, int block_idx);
+
   void initializeBlockHeader_fix(int block_idx, int record_size);
   void initializeBlockHeader_var(int block_idx);
 
@@ -37,6 +53,8 @@ public:
               const std::vector<char> &record);
   bool insert_fix(Relation &rel, const std::vector<char> &record);
   bool insert_var(Relation &rel, const std::vector<char> &record);
+  int insertIntoFreeBlock_var(const Relation &rel,
+                              const std::vector<char> &record);
 
   void insertFromShell(const std::string &relation_name,
                        const std::vector<std::string> &values);
@@ -84,7 +102,7 @@ public:
   void deleteWhere_var(const std::string &relation_name,
                        const std::string &field_name, const std::string &value,
                        const std::string &op);
-  void compactBlock_var(int block_idx);
+  void compactBlock_var(WritePageGuard &page);
 
   void modifyFromShell(const std::string &relation_name,
                        const std::string &field_name, const std::string &value,
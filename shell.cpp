@@ -1,5 +1,6 @@
-#include "hash_index.h"
+#include "bench.h"
 #include "shell.h"
+#include <charconv>
 #include <cstdio>
 #include <string>
 
@@ -33,6 +34,18 @@ std::vector<std::string> split(const std::string &line) {
   return tokens;
 }
 
+// Entero completo, sin basura al final ni desborde; si no lo es avisa por
+// stderr y devuelve false, asi un argumento mal escrito no corta el shell
+static bool parseInt(const std::string &text, int &value) {
+  const char *end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  if (ec != std::errc() || ptr != end) {
+    std::cerr << "Numero invalido: " << text << std::endl;
+    return false;
+  }
+  return true;
+}
+
 Shell::Shell(SGBD &sgbd) : sgbd(sgbd) {}
 
 void Shell::run() {
@@ -41,13 +54,15 @@ void Shell::run() {
     std::cout << "> ";
     if (!std::getline(std::cin, line))
       break;
+    sgbd.scheduler.resetQueryStats();
     if (!handleCommand(line))
       break;
+    sgbd.checkpointer.commit();
+    sgbd.checkpointer.maybeCheckpoint();
+    sgbd.bufferManager->trickleDirty();
+    sgbd.scheduler.printQueryStats();
   }
-  sgbd.catalog.save();
-  sgbd.bitmap.save();
-  sgbd.bufferManager->flushAll();
-  HashIndex::saveAllToDisk(sgbd.disk);
+  sgbd.checkpointer.checkpoint();
   std::cout << "Saliendo del sistema..." << std::endl;
 }
 
@@ -132,6 +147,52 @@ bool Shell::handleCommand(const std::string &line) {
     sgbd.modifyFromShell(relation_name, field_name, value, new_values);
   } else if (cmd == "hash_info" && tokens.size() == 2) {
     sgbd.printHashIndexStatus(tokens[1]);
+  } else if (cmd == "io_sched") {
+    if (tokens.size() == 2 && !sgbd.scheduler.setPolicy(tokens[1]))
+      std::cerr << "Politica invalida (fcfs / scan / clook)" << std::endl;
+    sgbd.scheduler.printInfo();
+  } else if (cmd == "io_stats" && tokens.size() <= 2) {
+    if (tokens.size() == 2 && tokens[1] == "reset") {
+      sgbd.disk.resetIOStats();
+      std::cout << "Estadisticas de E/S reiniciadas." << std::endl;
+    } else {
+      sgbd.disk.printIOStats();
+    }
+  } else if (cmd == "buffer_resize" && tokens.size() == 2) {
+    int frames;
+    if (parseInt(tokens[1], frames) && sgbd.bufferManager->resize(frames))
+      std::cout << "Buffer pool: " << sgbd.bufferManager->frameCount() << " frames" << std::endl;
+  } else if (cmd == "buffer_policy" && tokens.size() <= 2) {
+    if (tokens.size() == 1 || sgbd.bufferManager->setPolicy(tokens[1]))
+      std::cout << "Politica de reemplazo: " << sgbd.bufferManager->policyName() << std::endl;
+  } else if (cmd == "prefetch" && tokens.size() <= 2) {
+    int window;
+    if (tokens.size() == 2) {
+      if (!parseInt(tokens[1], window))
+        return true;
+      sgbd.bufferManager->setPrefetchWindow(window);
+    }
+    sgbd.bufferManager->printPrefetchInfo();
+  } else if (cmd == "wal_info" && tokens.size() == 1) {
+    sgbd.wal.printStats();
+  } else if (cmd == "checkpoint" && tokens.size() == 1) {
+    sgbd.checkpointer.checkpoint();
+    sgbd.checkpointer.printStats();
+  } else if (cmd == "bench_scan" && (tokens.size() == 2 || tokens.size() == 3)) {
+    int passes = 1;
+    if (tokens.size() == 3 && !parseInt(tokens[2], passes))
+      return true;
+    benchColdScan(sgbd, tokens[1], passes);
+  } else if (cmd == "bench_lru" && tokens.size() <= 2) {
+    int max_frames = 100000;
+    if (tokens.size() == 2 && !parseInt(tokens[1], max_frames))
+      return true;
+    benchLRUMiss(sgbd, max_frames);
+  } else if (cmd == "bench_policies" && tokens.size() <= 2) {
+    int frames = 64;
+    if (tokens.size() == 2 && !parseInt(tokens[1], frames))
+      return true;
+    benchPolicies(sgbd, frames);
   } else {
     std::cout << "Comando no reconocido." << std::endl;
   }
@@ -0,0 +1,233 @@
+#include "wal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+WriteAheadLog::WriteAheadLog(Disk &disk_)
+    : disk(disk_), path((fs::path(disk_.root_path) / "wal.log").string()),
+      is_enabled(disk_.intOption("wal", 1) != 0),
+      group_size(std::max(1, disk_.intOption("wal_group_commit", 8))),
+      group_ms(std::max(0, disk_.intOption("wal_group_ms", 100))) {
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    throw std::runtime_error("No se pudo abrir el log: " + path);
+  if (is_enabled) flusher = std::thread(&WriteAheadLog::runFlusher, this);
+}
+
+// Los commits que quedaron en el grupo se hacen durables antes de cerrar
+WriteAheadLog::~WriteAheadLog() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    try {
+      if (pending_commits > 0) flushLocked();
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+    }
+  }
+  pending_cv.notify_one();
+  if (flusher.joinable()) flusher.join();
+  if (fd != -1) ::close(fd);
+}
+
+// Vuelca el grupo abierto cuando pasan group_ms desde su primer COMMIT
+void WriteAheadLog::runFlusher() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    pending_cv.wait(lock, [&] { return stopping || pending_commits > 0; });
+    if (stopping) return;
+    auto deadline = first_pending + std::chrono::milliseconds(group_ms);
+    if (pending_cv.wait_until(lock, deadline, [&] { return stopping || pending_commits == 0; }))
+      continue;
+    try {
+      flushLocked();
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+      first_pending = std::chrono::steady_clock::now(); // reintenta en group_ms
+    }
+  }
+}
+
+// FNV-1a: alcanza para detectar un registro escrito a medias al final
+uint32_t WriteAheadLog::checksum(const char *data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void WriteAheadLog::append(RecordType type, int block_idx, int offset, const char *data,
+                           int length) {
+  RecordHeader header{0, type, next_lsn++, block_idx, static_cast<uint32_t>(offset),
+                      static_cast<uint32_t>(length)};
+
+  size_t start = buffer.size();
+  buffer.resize(start + sizeof(header) + length);
+  std::memcpy(buffer.data() + start, &header, sizeof(header));
+  if (length > 0) std::memcpy(buffer.data() + start + sizeof(header), data, length);
+
+  header.checksum = checksum(buffer.data() + start + sizeof(uint32_t),
+                             sizeof(header) - sizeof(uint32_t) + length);
+  std::memcpy(buffer.data() + start, &header.checksum, sizeof(uint32_t));
+
+  ++records;
+  bytes_logged += sizeof(header) + length;
+  if (buffer.size() >= BUFFER_LIMIT) writeBuffer();
+}
+
+uint64_t WriteAheadLog::logUpdate(int block_idx, int offset, const char *data, int length) {
+  if (!is_enabled) return 0;
+  std::lock_guard<std::mutex> lock(mutex);
+  append(UPDATE, block_idx, offset, data, length);
+  open_transaction = true;
+  return next_lsn - 1;
+}
+
+void WriteAheadLog::commit() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!is_enabled || !open_transaction) return;
+  append(COMMIT, -1, 0, nullptr, 0);
+  open_transaction = false;
+  ++commits;
+
+  auto now = std::chrono::steady_clock::now();
+  if (pending_commits++ == 0) first_pending = now;
+  if (pending_commits >= group_size ||
+      now - first_pending >= std::chrono::milliseconds(group_ms))
+    flushLocked();
+  else if (pending_commits == 1)
+    pending_cv.notify_one();
+}
+
+// Escribe lo acumulado sin fsync
+void WriteAheadLog::writeBuffer() {
+  size_t done = 0;
+  while (done < buffer.size()) {
+    ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error("No se pudo escribir el log: " + std::string(std::strerror(errno)));
+    }
+    done += n;
+  }
+  buffer.clear();
+}
+
+void WriteAheadLog::flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  flushLocked();
+}
+
+void WriteAheadLog::flushLocked() {
+  if (durable_lsn + 1 == next_lsn) return;
+  writeBuffer();
+  if (::fdatasync(fd) != 0)
+    throw std::runtime_error("No se pudo sincronizar el log: " + path);
+  ++fsyncs;
+  durable_lsn = next_lsn - 1;
+  pending_commits = 0;
+}
+
+void WriteAheadLog::flushTo(uint64_t lsn) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (lsn > durable_lsn) flushLocked();
+}
+
+// Reaplica, en orden, los cambios de las transacciones con COMMIT. Lo que
+// sigue al ultimo COMMIT (o a un registro corrupto) se descarta. Las imagenes
+// de rangos son idempotentes, asi que reaplicar algo ya escrito no cambia nada.
+int WriteAheadLog::recover() {
+  off_t size = ::lseek(fd, 0, SEEK_END);
+  if (size <= 0) return 0;
+
+  std::vector<char> log(size);
+  if (::pread(fd, log.data(), size, 0) != size)
+    throw std::runtime_error("No se pudo leer el log: " + path);
+
+  std::map<int, std::vector<char>> pages;
+  std::vector<std::pair<RecordHeader, size_t>> pending;
+  int transactions = 0;
+  size_t applied = 0;
+  size_t pos = 0;
+
+  while (pos + sizeof(RecordHeader) <= log.size()) {
+    RecordHeader header;
+    std::memcpy(&header, log.data() + pos, sizeof(header));
+    size_t record_size = sizeof(header) + header.length;
+    if (pos + record_size > log.size() ||
+        checksum(log.data() + pos + sizeof(uint32_t), record_size - sizeof(uint32_t)) !=
+            header.checksum)
+      break;
+
+    if (header.type == UPDATE) {
+      if (header.block_idx < 0 || header.block_idx >= disk.totalBlocks() ||
+          header.offset + header.length > static_cast<uint32_t>(disk.block_size))
+        break;
+      pending.emplace_back(header, pos + sizeof(header));
+    } else if (header.type == COMMIT) {
+      for (const auto &[update, data] : pending) {
+        auto it = pages.find(update.block_idx);
+        if (it == pages.end())
+          it = pages.emplace(update.block_idx, disk.readBlock(update.block_idx)).first;
+        std::memcpy(it->second.data() + update.offset, log.data() + data, update.length);
+      }
+      applied += pending.size();
+      pending.clear();
+      ++transactions;
+    } else {
+      break;
+    }
+    pos += record_size;
+  }
+
+  for (const auto &[block_idx, data] : pages)
+    disk.writeBlock(block_idx, data);
+  disk.sync();
+
+  if (transactions > 0)
+    std::cout << "WAL: " << transactions << " transacciones recuperadas (" << applied
+              << " cambios en " << pages.size() << " bloques)" << std::endl;
+  truncate();
+  return transactions;
+}
+
+// Solo despues de volcar todas las paginas sucias
+void WriteAheadLog::truncate() {
+  std::lock_guard<std::mutex> lock(mutex);
+  buffer.clear();
+  if (::ftruncate(fd, 0) != 0 || ::fdatasync(fd) != 0)
+    throw std::runtime_error("No se pudo truncar el log: " + path);
+  durable_lsn = next_lsn - 1;
+  pending_commits = 0;
+  open_transaction = false;
+}
+
+void WriteAheadLog::printStats() const {
+  std::cout << "==== Write-ahead log ====" << std::endl;
+  if (!is_enabled) {
+    std::cout << "Desactivado (wal=0)" << std::endl;
+    return;
+  }
+  std::cout << "Archivo           : " << path << std::endl;
+  std::cout << "Group commit      : " << group_size << " commits o " << group_ms << " ms"
+            << std::endl;
+  std::cout << "Commits           : " << commits << std::endl;
+  std::cout << "Registros         : " << records << " (" << bytes_logged << " bytes)"
+            << std::endl;
+  std::cout << "fsync             : " << fsyncs;
+  if (fsyncs > 0)
+    std::cout << " (" << static_cast<double>(commits) / fsyncs << " commits por fsync)";
+  std::cout << std::endl;
+  std::cout << "Pendientes        : " << pending_commits << std::endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "disk.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Registro de escritura anticipada (solo redo). Cada cambio a un bloque de
+// datos se registra como la imagen nueva de un rango de bytes; un comando de
+// la shell es una transaccion que termina con un registro COMMIT.
+//
+// Group commit: los COMMIT se acumulan en memoria y un solo fsync los hace
+// durables cuando hay wal_group_commit pendientes o pasaron wal_group_ms
+// desde el primero; un hilo vuelca el grupo al vencer wal_group_ms aunque no
+// lleguen mas commits. Antes de escribir una pagina sucia el buffer manager
+// llama a flushTo con el LSN de la pagina; los shards del pool lo hacen desde
+// varios hilos, asi que las operaciones publicas toman un mutex.
+class WriteAheadLog {
+public:
+  WriteAheadLog(Disk &disk);
+  ~WriteAheadLog();
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+  bool enabled() const { return is_enabled; }
+
+  uint64_t logUpdate(int block_idx, int offset, const char *data, int length);
+  void commit();
+  void flushTo(uint64_t lsn);
+  void flush();
+
+  int recover();
+  void truncate();
+
+  void printStats() const;
+
+private:
+  enum RecordType : uint32_t { UPDATE = 1, COMMIT = 2 };
+
+  struct RecordHeader {
+    uint32_t checksum;
+    uint32_t type;
+    uint64_t lsn;
+    int32_t block_idx;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  static constexpr size_t BUFFER_LIMIT = 64 * 1024;
+
+  Disk &disk;
+  std::mutex mutex;
+  std::condition_variable pending_cv;
+  std::string path;
+  int fd = -1;
+  bool is_enabled;
+  int group_size;
+  int group_ms;
+
+  std::vector<char> buffer;
+  uint64_t next_lsn = 1;
+  uint64_t durable_lsn = 0;
+  bool open_transaction = false;
+  int pending_commits = 0;
+  std::chrono::steady_clock::time_point first_pending;
+  bool stopping = false;
+  std::thread flusher;
+
+  uint64_t commits = 0;
+  uint64_t records = 0;
+  uint64_t bytes_logged = 0;
+  uint64_t fsyncs = 0;
+
+  void append(RecordType type, int block_idx, int offset, const char *data, int length);
+  void writeBuffer();
+  void flushLocked();
+  void runFlusher();
+  static uint32_t checksum(const char *data, size_t len);
+};